@@ -0,0 +1,20 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include "threads.hpp"
+
+constexpr int BENCH_DEFAULT_DEPTH = 5;
+
+// Benchmarks reachable from the UCI loop
+void runBench(int depth, int threads, int hashMB, const PruningOptions& pruning = PruningOptions());
+void ttReuseBench(int movetimeMs, int plies);
+void smpScalingBench(int depth, int maxThreads);
+void ponderBench(int movetimeMs, int plies);
+void allocBench(int depth);
+void makeUnmakeBench(int rounds);
+void qsearchBench(int rounds);
+void moveOrderBench(int rounds);
+void epdBench(int depth, int movetimeMs, const std::string& file,
+              const PruningOptions& pruning = PruningOptions());
+
+#endif // BENCH_HPP
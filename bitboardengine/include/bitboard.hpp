@@ -2,13 +2,17 @@
 #ifndef BITBOARD_HPP
 #define BITBOARD_HPP
 #include <random>
+#include <cassert>
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <string>
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
-#include <unordered_map>
+#include <vector>
+#include <atomic>
+#include <memory>
 
 enum PieceIndex {
     WHITE_PAWNS = 0,
@@ -25,6 +29,8 @@ enum PieceIndex {
     BLACK_KINGS = 11
 };
 
+constexpr int NO_PIECE = -1;  // Empty square in the mailbox
+
 
 // Move encoding constants
 constexpr int SPECIAL_NONE = 0x0;        // 0000
@@ -50,16 +56,65 @@ extern uint64_t zobristCastling[16];
 extern uint64_t zobristEnPassant[8];
 extern uint64_t zobristSideToMove;
 
+// Transposition table sizing and packing
+constexpr int TT_DEFAULT_SIZE_MB = 16;
+constexpr int TT_MAX_SIZE_MB = 4096;
+constexpr int TT_CLUSTER_SIZE = 5;      // Entries per 64-byte cluster
+constexpr int TT_DEPTH_OFFSET = 8;      // Stored depth = depth + offset, 0 marks an empty slot
+constexpr int TT_GENERATION_BITS = 2;   // Low bits of genBound hold the bound type
+constexpr int TT_GENERATION_DELTA = (1 << TT_GENERATION_BITS);
+constexpr int TT_GENERATION_CYCLE = 255 + TT_GENERATION_DELTA;
+constexpr int TT_GENERATION_MASK = (0xFF << TT_GENERATION_BITS) & 0xFF;
+
+// Decoded view of a transposition table slot
 struct TranspositionTableEntry {
-    int visitCount = 0;       // Default visit count
     uint16_t bestMove = 0;    // Default best move (0 indicates unknown)
     int evaluation = UNKNOWN_EVAL;  // Default evaluation
     int depth = -1;           // Default depth (-1 indicates uninitialized depth)
     int eval_type = EXACT_SCORE;
 };
 
-using TranspositionTable = std::unordered_map<uint64_t, TranspositionTableEntry>;
+/*
+One cache line worth of entries. Each slot is a 32-bit partial key (upper half of the
+Zobrist hash, the lower half picks the cluster) plus a 64-bit data word packing
+move (16) | depth (8) | generation+bound (8) | score (32).
+
+The table is shared by all search threads without locks: both words are relaxed atomics
+and the key is stored XORed with the data, so a slot torn by two concurrent writers
+simply fails the key check instead of returning a mismatched move or score.
+*/
+struct alignas(64) TTCluster {
+    std::atomic<uint64_t> data[TT_CLUSTER_SIZE];
+    std::atomic<uint32_t> keys[TT_CLUSTER_SIZE];
+    uint32_t padding;
+};
+static_assert(sizeof(TTCluster) == 64, "TTCluster must fill exactly one cache line");
+
+class TranspositionTable {
+   public:
+    explicit TranspositionTable(size_t sizeMB = TT_DEFAULT_SIZE_MB);
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    void resize(size_t sizeMB);
+    void clear();
+    void newSearch();
 
+    bool probe(uint64_t hash, TranspositionTableEntry& entry) const;
+    void store(uint64_t hash, uint16_t bestMove, int evaluation, int depth, int eval_type);
+
+    int hashfull() const;
+    size_t sizeMB() const;
+
+   private:
+    std::unique_ptr<TTCluster[]> clusters;
+    size_t clusterCount;
+    uint64_t clusterMask;
+    uint8_t generation8;
+
+    size_t clusterIndex(uint64_t hash) const { return hash & clusterMask; }
+    int relativeAge(uint8_t genBound8) const;
+};
 
 // Function to convert algebraic notation (e.g., "e3") to square index (0-63)
 int algebraicToSquare(const std::string& algebraic);
@@ -68,11 +123,27 @@ std::string squareToAlgebraic(int square);
 
 std::string bitboardToBinaryString(uint64_t bitboard);
 
+constexpr int STATE_STACK_SIZE = 160;  // StateInfo ring buffer; deeper than any search line
+
+/*
+Check and pin information of a position, computed once by updateStateInfo when the
+position is set up or a move is made. Arrays indexed by side use 0 for white, 1 for black.
+*/
+struct StateInfo {
+    uint64_t checkers;         // Enemy pieces giving check to the side to move
+    uint64_t blockers[2];      // Pieces (of either side) that alone shield the king from a slider
+    uint64_t pinners[2];       // Enemy sliders pinning one of the side's pieces to its king
+    uint64_t checkSquares[6];  // Per piece kind, squares the side to move would check from
+};
+
 class BoardState {
 private:
     // 12 bitboards, one for each piece type (6 for white, 6 for black)
     std::array<uint64_t, 12> bitboards;
 
+    // Piece on each square (PieceIndex or NO_PIECE), kept in sync with the bitboards
+    std::array<int8_t, 64> mailbox;
+
     // Additional board state data
     uint64_t white_occupancy;
     uint64_t black_occupancy;
@@ -84,13 +155,33 @@ private:
     int fullmove_number;
     uint64_t zobrist_hash;
 
+    // StateInfo of the current position and the ones before it. It is a ring buffer, so
+    // a game longer than the buffer just overwrites positions that are never unmade.
+    // A copy of the board only carries the current slot (see the copy constructor).
+    std::array<StateInfo, STATE_STACK_SIZE> states;
+    int stateIndex;
+
+    void copyFrom(const BoardState& other);
+
 public:
     // Constructor, getters, and setters
     BoardState();
+    BoardState(const BoardState& other);
+    BoardState& operator=(const BoardState& other);
 
     // Methods to manipulate bitboards
     void updateBitboard(int pieceType, uint64_t newBitboard);
-    uint64_t getBitboard(int pieceType) const;
+    uint64_t getBitboard(int pieceType) const {
+        assert(pieceType >= 0 && pieceType < 12);
+        return bitboards[pieceType];
+    }
+    int pieceOn(int square) const { return mailbox[square]; }
+
+    // Piece-level updates used by make/unmake. Bitboards, occupancies and the mailbox are
+    // all updated by XOR; the Zobrist key is left to the caller.
+    void putPiece(int pieceType, int square);
+    void removePiece(int square);
+    void movePiece(int fromSquare, int toSquare);
 
     void setOccupancy(uint64_t white, uint64_t black);
     uint64_t getOccupancy(bool isWhite) const;
@@ -121,11 +212,52 @@ public:
     void setZobristHash(uint64_t zobrist);
     uint64_t getZobristHash() const;
 
+    // Check and pin information of the current position
+    const StateInfo& stateInfo() const { return states[stateIndex]; }
+    StateInfo& stateInfo() { return states[stateIndex]; }
+    // Make a move: a fresh slot, filled by updateStateInfo
+    void pushState() { stateIndex = stateIndex == STATE_STACK_SIZE - 1 ? 0 : stateIndex + 1; }
+    // Unmake it: the previous slot is still valid
+    void popState() { stateIndex = stateIndex == 0 ? STATE_STACK_SIZE - 1 : stateIndex - 1; }
+    uint64_t getCheckers() const { return states[stateIndex].checkers; }
+
     friend bool operator==(const BoardState& lhs, const BoardState& rhs);
     // Overload the << operator to visualize the board state
     friend std::ostream& operator<<(std::ostream& os, const BoardState& board);
 };
 
+inline void BoardState::putPiece(int pieceType, int square) {
+    assert(pieceType >= 0 && pieceType < 12 && square >= 0 && square < 64);
+    assert(mailbox[square] == NO_PIECE);
+    uint64_t mask = 1ULL << square;
+    bitboards[pieceType] ^= mask;
+    (pieceType < BLACK_PAWNS ? white_occupancy : black_occupancy) ^= mask;
+    all_occupancy ^= mask;
+    mailbox[square] = pieceType;
+}
+
+inline void BoardState::removePiece(int square) {
+    assert(square >= 0 && square < 64 && mailbox[square] != NO_PIECE);
+    int pieceType = mailbox[square];
+    uint64_t mask = 1ULL << square;
+    bitboards[pieceType] ^= mask;
+    (pieceType < BLACK_PAWNS ? white_occupancy : black_occupancy) ^= mask;
+    all_occupancy ^= mask;
+    mailbox[square] = NO_PIECE;
+}
+
+inline void BoardState::movePiece(int fromSquare, int toSquare) {
+    assert(fromSquare >= 0 && fromSquare < 64 && toSquare >= 0 && toSquare < 64);
+    assert(mailbox[fromSquare] != NO_PIECE && mailbox[toSquare] == NO_PIECE);
+    int pieceType = mailbox[fromSquare];
+    uint64_t fromToMask = (1ULL << fromSquare) | (1ULL << toSquare);
+    bitboards[pieceType] ^= fromToMask;
+    (pieceType < BLACK_PAWNS ? white_occupancy : black_occupancy) ^= fromToMask;
+    all_occupancy ^= fromToMask;
+    mailbox[toSquare] = pieceType;
+    mailbox[fromSquare] = NO_PIECE;
+}
+
 // FEN utility
 
 int charToPieceIndex(char piece);
@@ -147,8 +279,5 @@ void updateTranspositionTable(TranspositionTable& table, uint64_t hash, uint16_t
 
 bool getTranspositionTableEntry(const TranspositionTable& table, uint64_t hash,
                                 TranspositionTableEntry& entry);
-                                
-void incrementVisitCount(TranspositionTable& table, uint64_t hash);
-void decrementVisitCount(TranspositionTable& table, uint64_t hash);
 
 #endif // BITBOARD_HPP
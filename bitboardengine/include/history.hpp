@@ -0,0 +1,43 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+constexpr int HISTORY_MAX = 16384;        // Every score stays within +-HISTORY_MAX
+constexpr int HISTORY_BONUS_MAX = 1200;   // Largest change a single cutoff makes
+constexpr int CONTINUATION_PLIES = 2;     // Continuation history follows the last two moves
+constexpr int HISTORY_MOVES_TRIED = 32;   // Moves per kind given the malus at a cutoff
+
+// Scores indexed by [piece][to square]
+typedef std::array<std::array<int16_t, 64>, 12> PieceToHistory;
+
+/*
+Move ordering statistics learned from beta cutoffs. Every search thread keeps its own
+tables, so they are never shared or locked. They outlive a single search and are aged
+at the start of the next one; `ucinewgame` clears them.
+*/
+struct HistoryTables {
+    std::array<std::array<uint16_t, 64>, 12> counterMoves;  // [piece][to] of the previous move
+    std::array<std::array<std::array<int16_t, 64>, 64>, 2> butterfly;  // [side][from][to]
+    std::array<std::array<PieceToHistory, 64>, 12> continuation;  // [piece][to] of a prior move
+    std::array<std::array<std::array<int16_t, 6>, 64>, 12> captures;  // [piece][to][captured kind]
+
+    void clear();
+    void age();
+};
+
+// Bonus for the move that caused a cutoff at this depth; the moves tried before it get
+// the same amount as a malus
+inline int historyBonus(int depth) {
+    int bonus = 16 * depth * depth + 32 * depth + 16;
+    return bonus < HISTORY_BONUS_MAX ? bonus : HISTORY_BONUS_MAX;
+}
+
+// Gravity: an entry moves towards +-HISTORY_MAX by less the closer it already is
+inline void updateHistory(int16_t& entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
+
+#endif // HISTORY_HPP
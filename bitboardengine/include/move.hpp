@@ -1,33 +1,108 @@
 #ifndef MOVE_HPP
 #define MOVE_HPP
+#include <cassert>
+#include <functional>
 #include "bitboard.hpp"
 
+// More than the legal moves of any reachable position (the known maximum is 218)
+constexpr int MAX_MOVES = 256;
 
-struct MoveUndo {
+// A move together with the score it is ordered by
+struct ScoredMove {
     uint16_t move;
+    int score;
 
-    uint64_t fromBitboard;
-    int from_piece_type;
+    operator uint16_t() const { return move; }
 
-    uint64_t promotedBitboard;  // Only used in queening
-    int promotedPieceType;
+    // Higher scores first, ties broken by the move so the order is always the same
+    bool operator>(const ScoredMove& other) const {
+        return score != other.score ? score > other.score : move > other.move;
+    }
+};
 
-    uint64_t capturedBitboard;  // Only used when capturing
-    int captured_piece_type;
+/*
+Fixed size move list meant to live on the stack. Generators append to it directly, so
+producing and ordering the moves of a node never allocates.
+*/
+class MoveList {
+   public:
+    void push_back(uint16_t move, int score = 0) {
+        assert(count < MAX_MOVES);
+        moves[count++] = {move, score};
+    }
 
-    bool capture;
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
 
-    uint8_t enPassantState;  // Stores the en passant square
+    ScoredMove& operator[](size_t index) { return moves[index]; }
+    const ScoredMove& operator[](size_t index) const { return moves[index]; }
+
+    ScoredMove* begin() { return moves; }
+    ScoredMove* end() { return moves + count; }
+    const ScoredMove* begin() const { return moves; }
+    const ScoredMove* end() const { return moves + count; }
+
+    bool contains(uint16_t move) const {
+        for (size_t i = 0; i < count; ++i) {
+            if (moves[i].move == move) return true;
+        }
+        return false;
+    }
+
+    // Sorts by score, best first
+    void sort() { std::sort(begin(), end(), std::greater<ScoredMove>()); }
+
+   private:
+    ScoredMove moves[MAX_MOVES];
+    size_t count = 0;
+};
+
+/*
+A few moves the search keeps per node, where a full MoveList would make every frame of
+the recursion several kilobytes larger. Once full, further moves are not recorded.
+*/
+template <int CAPACITY>
+class BoundedMoveList {
+   public:
+    void push_back(uint16_t move) {
+        if (count < CAPACITY) moves[count++] = move;
+    }
+
+    size_t size() const { return count; }
+    bool full() const { return count == CAPACITY; }
+
+    uint16_t operator[](size_t index) const { return moves[index]; }
+    const uint16_t* begin() const { return moves; }
+    const uint16_t* end() const { return moves + count; }
+
+   private:
+    uint16_t moves[CAPACITY];
+    size_t count = 0;
+};
+
+
+/*
+Everything make/unmake cannot recompute. The pieces are put back from the move itself
+and the mailbox, the key is restored as it was, and the fullmove number is simply
+decremented after a black move.
+*/
+struct MoveUndo {
+    uint64_t zobristHash;    // Key before the move
+    uint16_t move;
+    uint16_t halfMoveClock;  // Tracks half-move clock for 50-move rule
+    int8_t capturedPiece;    // Captured piece type, NO_PIECE if none
     uint8_t castlingRights;  // Store castling rights
-    int halfMoveClock;       // Tracks half-move clock for 50-move rule
-    int moveCounter;         // Full move counter
+    uint8_t enPassantState;  // Stores the en passant square
 };
+static_assert(sizeof(MoveUndo) == 16, "MoveUndo should stay compact");
 
 std::string moveToString(uint16_t move);
 
-MoveUndo storeUndoData(const BoardState& board, uint16_t move);
 MoveUndo applyMove(BoardState& board, uint16_t move);
 void undoMove(BoardState& board, const MoveUndo& undoState);
+MoveUndo applyNullMove(BoardState& board);
+void undoNullMove(BoardState& board, const MoveUndo& undoState);
 
 uint16_t encodeMove(int fromSquare, int toSquare, int special = SPECIAL_NONE);
 void decodeMove(uint16_t move, int& fromSquare, int& toSquare, int& special);
@@ -10,15 +10,25 @@ extern std::array<uint64_t, 64> king_threats_table;
 extern std::array<uint64_t, 64> knight_threats_table;
 extern std::array<uint64_t, 64> wpawn_threats_table;
 extern std::array<uint64_t, 64> bpawn_threats_table;
+extern std::array<std::array<uint64_t, 64>, 64> between_table;
+extern std::array<uint64_t, 64> rook_rays_table;
+extern std::array<uint64_t, 64> bishop_rays_table;
 
 void initKingThreatMasks();
 void initKnightThreatMasks();
 void initPawnThreatMasks();
+void initBetweenMasks();
 
 uint64_t generateThreatMask(int pieceType, int attackerSquare, uint64_t allOccupancy);
 
+void updateStateInfo(BoardState& board);
 bool is_in_check(const BoardState& board);
-std::vector<uint16_t> allLegalMoves(const BoardState& board);
-std::vector<uint16_t> generateKingMoves(const BoardState& board);
+bool givesCheck(const BoardState& board, uint16_t move);
+bool isSquareAttacked(const BoardState& board, int square, uint64_t occupancy, bool byWhite);
+MoveList allLegalMoves(const BoardState& board);
+MoveList allLegalCaptures(const BoardState& board);  // Not in check only
+bool isPseudoLegal(const BoardState& board, uint16_t move);
+bool isLegal(const BoardState& board, uint16_t move);
+void generateKingMoves(const BoardState& board, MoveList& moves);
 
 #endif // MOVEGEN_HPP
@@ -0,0 +1,74 @@
+#ifndef MOVEPICK_HPP
+#define MOVEPICK_HPP
+
+#include "evaluate.hpp"
+#include "history.hpp"
+
+// Stages of the move picker, in the order their moves are handed out
+enum PickStage {
+    STAGE_TT_MOVE,
+    STAGE_GENERATE,
+    STAGE_GOOD_CAPTURES,
+    STAGE_REFUTATIONS,
+    STAGE_SCORE_QUIETS,
+    STAGE_QUIETS,
+    STAGE_BAD_CAPTURES,
+    STAGE_GENERATE_CHECKS,  // Quiescence search only
+    STAGE_QUIET_CHECKS,
+    STAGE_DONE
+};
+
+constexpr int KILLER_SLOTS = 2;
+constexpr int REFUTATION_SLOTS = KILLER_SLOTS + 1;  // The killers, then the counter move
+
+int see(const BoardState& board, int toSq, int target, int frSq, int aPiece);
+bool isNoisy(const BoardState& board, uint16_t move);
+
+/*
+Hands out the legal moves of a node one at a time, best first. Each stage only does its
+work once the moves before it are used up, so a node that fails high on an early move
+never scores, let alone sorts, the rest.
+*/
+class MovePicker {
+   public:
+    // The TT move must be legal in this position; 0 for none
+    explicit MovePicker(const BoardState& board, uint16_t ttMove = 0);
+
+    // With the search's killers and counter move, and history to order the rest by. The
+    // continuation rows belong to the moves 1 and 2 plies back, nullptr where there is none.
+    MovePicker(const BoardState& board, uint16_t ttMove, const HistoryTables& history,
+               const uint16_t killers[KILLER_SLOTS], uint16_t counterMove,
+               const PieceToHistory* const continuation[CONTINUATION_PLIES]);
+
+    // For quiescence search: captures and promotions that do not lose material, then quiet
+    // checks if `checks` is set. In check, every evasion instead.
+    MovePicker(const BoardState& board, uint16_t ttMove, const HistoryTables& history,
+               bool checks);
+
+    uint16_t nextMove();  // 0 once every move has been handed out
+
+   private:
+    const BoardState& board;
+    const HistoryTables* history;
+    const PieceToHistory* continuation[CONTINUATION_PLIES];
+    int stage;
+    uint16_t ttMove;
+    uint16_t refutations[REFUTATION_SLOTS];
+    int refutationIndex = 0;
+    bool captureOnly = false;  // Quiescence search outside check
+    bool quietChecks = false;
+
+    // Captures first, then quiets. Captures that fail SEE are moved down to the front of
+    // the list, behind the ones already handed out.
+    MoveList moves;
+    size_t current = 0;
+    size_t captureEnd = 0;
+    size_t badCaptureEnd = 0;
+
+    void generate();
+    int captureScore(uint16_t move) const;
+    int quietScore(uint16_t move) const;
+    bool isSkipped(uint16_t move) const;
+};
+
+#endif // MOVEPICK_HPP
@@ -0,0 +1,39 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+constexpr int OUTPUT_FLUSH_INTERVAL_MS = 50;  // Buffered lines wait at most this long
+constexpr int CURRMOVE_MIN_TIME_MS = 3000;    // currmove lines only after this much search time
+
+/*
+Thread-safe, buffered writer for everything the engine sends to the GUI.
+Search threads only append to a string; the stream is written at most once per
+flush interval, or at once for lines the GUI waits on (bestmove, readyok).
+Frequent low-value lines (currmove) are dropped when they come too fast.
+*/
+class OutputWriter {
+   public:
+    explicit OutputWriter(std::ostream& out);
+
+    void write(const std::string& line, bool flushNow = false);
+    void writeThrottled(const std::string& line);
+    void flushIfDue();
+    void flush();
+
+   private:
+    void flushLocked();
+
+    std::ostream& out;
+    std::mutex mutex;
+    std::string buffer;
+    std::chrono::steady_clock::time_point lastFlush;
+    std::chrono::steady_clock::time_point lastThrottled;
+};
+
+extern OutputWriter uciOutput;  // Wraps std::cout
+
+#endif // OUTPUT_HPP
@@ -0,0 +1,38 @@
+#ifndef PERFT_HPP
+#define PERFT_HPP
+
+#include "movegen.hpp"
+#include <atomic>
+#include <memory>
+
+constexpr int PERFT_DEFAULT_HASH_MB = 0;  // No perft hash unless asked for
+constexpr int PERFT_CHECK_DEPTH = 3;      // Depth the suite checks givesCheck to
+
+/*
+Hash table of subtree leaf counts, keyed by Zobrist hash and depth. Shared by all perft
+threads without locks: each slot stores the key XORed with its data, so a torn write
+reads as a miss.
+*/
+class PerftTable {
+   public:
+    explicit PerftTable(int sizeMB);
+
+    bool enabled() const { return slotCount > 0; }
+    bool probe(uint64_t hash, int depth, uint64_t& count) const;
+    void store(uint64_t hash, int depth, uint64_t count);
+
+   private:
+    struct Slot {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;  // count << 8 | depth
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t slotCount;
+};
+
+uint64_t perft(BoardState& board, int depth, PerftTable* table = nullptr);
+uint64_t perftDivide(const BoardState& board, int depth, int threads, int hashMB, bool print);
+void runPerft(int depth, int threads, int hashMB, bool divide, const BoardState& board);
+void runPerftSuite(int threads, int hashMB);
+
+#endif // PERFT_HPP
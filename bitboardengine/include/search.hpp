@@ -2,58 +2,209 @@
 #define SEARCH_HPP
 
 #include <evaluate.hpp>
+#include "timeman.hpp"
+#include "output.hpp"
+#include "movepick.hpp"
 #include <string>
 #include <algorithm>
 #include <chrono>
+#include <memory>
+
+constexpr int MAX_SEARCH_PLY = 128;
+static_assert(STATE_STACK_SIZE > MAX_SEARCH_PLY + 1, "Search lines must fit the StateInfo stack");
+constexpr int DEFAULT_MAX_DEPTH = 12;
+constexpr int MATE_SCORE = 100000;                     // Score of mate at the root, minus the ply
+constexpr int MATE_BOUND = MATE_SCORE - MAX_SEARCH_PLY;  // Scores beyond this are mates
+constexpr int ASPIRATION_MIN_DEPTH = 4;  // Shallower iterations use the full window
+constexpr int ASPIRATION_WINDOW = 50;    // Initial half-width of the root window
+
+// Forward pruning
+constexpr int NULL_MOVE_MIN_DEPTH = 3;
+constexpr int NULL_MOVE_VERIFY_DEPTH = 8;      // Null move cutoffs from here on are verified
+constexpr int REVERSE_FUTILITY_MAX_DEPTH = 6;
+constexpr int REVERSE_FUTILITY_MARGIN = 90;    // Per ply of depth
+constexpr int RAZORING_MAX_DEPTH = 2;
+constexpr int RAZORING_MARGIN = 250;           // Per ply of depth
+constexpr int FUTILITY_MAX_DEPTH = 3;
+constexpr int FUTILITY_MARGIN = 120;           // Per ply of depth
+constexpr int LATE_MOVE_PRUNING_MAX_DEPTH = 4; // Quiets after the first 3 + depth^2 are skipped
+
+// Late move reductions
+constexpr int LMR_MIN_DEPTH = 3;
+constexpr double LMR_BASE = 0.5;               // Reduction = base + ln(depth) * ln(move) / divisor
+constexpr double LMR_DIVISOR = 2.25;
+constexpr int LMR_HISTORY_DIVISOR = 8192;      // A ply less reduction per this much history
+
+// Quiescence search, which stores its results under these depths
+constexpr int QS_DEPTH_CHECKS = 0;      // First ply, with quiet checks when they are enabled
+constexpr int QS_DEPTH_NO_CHECKS = -1;  // Captures and promotions only
+constexpr int DELTA_MARGIN = 200;       // Captures this far short of alpha are skipped
+
+// Extensions
+constexpr int EXTENSION_PLY_RATE = 2;          // At most one ply of extension per 2 plies
+constexpr int SINGULAR_MIN_DEPTH = 6;
+constexpr int SINGULAR_TT_DEPTH_MARGIN = 3;    // The TT score must come from depth - 3 or more
+constexpr int SINGULAR_MARGIN = 2;             // Per ply of depth, below the TT score
+
+// Forward pruning, reduction and extension techniques, each of which can be switched off
+// from UCI to measure it
+struct PruningOptions {
+    bool nullMove = true;
+    bool reverseFutility = true;
+    bool razoring = true;
+    bool futility = true;
+    bool lateMovePruning = true;
+    bool lateMoveReductions = true;
+    bool checkExtension = true;
+    bool singularExtension = true;
+    bool recaptureExtension = true;
+    bool qsearchChecks = false;  // Quiet checks on the first quiescence ply
+};
+
+void initReductions();
+
+// Counters collected while searching, used by the benchmarks and info output
+struct SearchStats {
+    std::atomic<uint64_t> nodes{0};  // Read by other threads while searching
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t ttCutoffs = 0;  // Hits deep enough to return a score without searching
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;  // Beta cutoffs on the first move searched
+};
+
+// Limits given to a search by the `go` command
+struct SearchLimits {
+    int wtime = -1;                 // Clock times in milliseconds, -1 when not given
+    int btime = -1;
+    int winc = 0;
+    int binc = 0;
+    int movestogo = 0;              // 0 means sudden death
+    int movetime = -1;              // Fixed time for this move, -1 when not given
+    int depth = DEFAULT_MAX_DEPTH;  // Deepest iteration to run
+    uint64_t nodes = 0;             // Node budget over all threads, 0 for none
+    int mate = 0;                   // Stop once a mate in this many moves is found, 0 for none
+    std::vector<uint16_t> searchMoves;  // Root moves to consider, empty for all
+    bool infinite = false;          // Keep the result until `stop`, even after the last iteration
+    bool ponder = false;            // Searching the opponent's time until `ponderhit` or `stop`
+};
+
+struct SearchContext;
+class SearchingMovesTable;
+class ThreadPool;
 
 class Search {
    public:
-    // Constructor
-    Search(BoardState& board, TranspositionTable& table, int timeLimitMs);
+    // Constructor. Thread 0 owns the clock; helper threads only watch the shared stop flag.
+    // Without history tables of its own thread, the search starts from empty ones.
+    Search(const BoardState& board, SearchContext& context, const SearchLimits& limits,
+           int threadId = 0, std::atomic<bool>* stopSignal = nullptr, bool printInfo = false,
+           HistoryTables* history = nullptr);
 
     // Main entry point for search
     uint16_t iterativeDeepening();
     uint16_t searchToDepth(int depth);
+    int quiescence();
+
+    const SearchStats& getStats() const { return stats; }
+    uint16_t getBestMoveSoFar() const { return bestMoveSoFar; }
+    int getCompletedDepth() const { return completedDepth; }
+    uint16_t getPonderMove();
 
    private:
     // Search parameters
-    int timeLimitMs;
+    TimeManager timeManager;  // Only used by thread 0
+    uint64_t nodeLimit;
+    int mateLimit;
+    std::vector<uint16_t> searchMoves;
     int maxDepth;
+    int threadId;
+    std::atomic<bool>* stopSignal;  // Shared by all threads of a parallel search
+    SearchingMovesTable* searchingMoves;  // Set only for an ABDADA search with helper threads
+    std::atomic<bool>* ponderSignal;      // Cleared by `ponderhit`
+    bool pondering;
+    const ThreadPool* pool;               // For node counts over all threads, or nullptr
+    bool printInfo;                       // Send UCI info lines (main thread of a `go` only)
+    PruningOptions pruning;
 
     // Search state
     uint16_t bestMoveSoFar;
     int bestEvalSoFar;
     int completedDepth;
     bool searchInterrupted;
-    std::chrono::steady_clock::time_point startTime;
+    int bestMoveStability;  // Iterations the best move has stayed the same
+    int timeCheckCountdown;
+    int selDepth;
+    bool verifyingNullMove;  // No null moves below a null move verification search
 
-    // Board and table as member variables
+    // Triangular PV table: pvTable[ply] holds the best line from that ply on
+    uint16_t pvTable[MAX_SEARCH_PLY + 1][MAX_SEARCH_PLY + 1];
+    int pvLength[MAX_SEARCH_PLY + 1];
+    std::vector<uint16_t> rootPV;
+
+    // The board is a private copy, the table belongs to the engine context
     BoardState board;
-    TranspositionTable table;
+    TranspositionTable& table;
+    SearchStats stats;
+
+    // Zobrist keys indexed by ply: game history, then the root, then the search path
+    std::vector<uint64_t> keyStack;
+    int rootIndex;
+
+    MoveList scoredMoves;
+    MoveList orderedLegalMoves;
+
+    // Move ordering: history tables of the thread, killers and moves made by ply
+    HistoryTables* history;
+    std::unique_ptr<HistoryTables> ownHistory;  // Only when the thread has none
+    uint16_t killers[MAX_SEARCH_PLY + 1][KILLER_SLOTS];
+    uint16_t moveStack[MAX_SEARCH_PLY + 1];
+    int8_t pieceStack[MAX_SEARCH_PLY + 1];  // Piece moved at each ply
+    int8_t capturedStack[MAX_SEARCH_PLY + 1];  // Piece captured at each ply, NO_PIECE if none
 
-    std::vector<std::pair<int, uint16_t>> scoredMoves;
-    std::vector<uint16_t> orderedLegalMoves;
+    // Extensions: the move left out by a singular extension search at each ply, and the
+    // plies of extension on the path to each ply
+    uint16_t excludedMoves[MAX_SEARCH_PLY + 1];
+    int extensionStack[MAX_SEARCH_PLY + 1];
 
     // Helper functions
+    void countNode() {
+        stats.nodes.store(stats.nodes.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    }
+    int currentPly() const { return int(keyStack.size()) - 1 - rootIndex; }
+    void updatePV(int ply, uint16_t move);
+    void printIterationInfo(int depth, int score);
     bool shouldStopSearch();
-    void getBestMove(int depth);
+    MoveUndo makeMove(uint16_t move);
+    void unmakeMove(const MoveUndo& undoData);
+    MoveUndo makeNullMove();
+    void unmakeNullMove(const MoveUndo& undoData);
+    bool isRepetition() const;
+    int getBestMove(int depth, int alpha, int beta);
+    void aspirationSearch(int depth);
+    int gameOverScore(GameResult result, int depth);
+    PieceToHistory* continuationRow(int ply, int pliesBack) const;
+    void updateHistories(int ply, int depth, uint16_t bestMove,
+                         const BoundedMoveList<HISTORY_MOVES_TRIED>& quietsTried,
+                         const BoundedMoveList<HISTORY_MOVES_TRIED>& capturesTried);
     int negamax(int depth, int alpha, int beta);
-    int QSearch(int alpha, int beta);
+    int QSearch(int alpha, int beta, int depth = QS_DEPTH_CHECKS);
 };
 
 // Search functions
 // uint16_t getBestMove(BoardState& board, TranspositionTable& table, int depth);
 // void Search::getBestMove(int depth);
 
-std::vector<uint16_t> orderMoves(BoardState& board, const std::vector<uint16_t>& moves);
+void orderMoves(BoardState& board, MoveList& moves);
 
 // Game-ending conditions
-// GameResult gameOver(const BoardState& board, const std::vector<uint16_t>& legalMoves, TranspositionTable& table);
+// GameResult gameOver(const BoardState& board, const MoveList& legalMoves);
 // bool insufficientMaterial(const BoardState& board);
-// bool whiteCheckmate(const BoardState& board, const std::vector<uint16_t>& legalMoves);
-// bool blackCheckmate(const BoardState& board, const std::vector<uint16_t>& legalMoves);
+// bool whiteCheckmate(const BoardState& board, const MoveList& legalMoves);
+// bool blackCheckmate(const BoardState& board, const MoveList& legalMoves);
 // bool fiftyMoveRule(const BoardState& board);
-// bool stalemate(const BoardState& board, const std::vector<uint16_t>& legalMoves);
+// bool stalemate(const BoardState& board, const MoveList& legalMoves);
 
 
 
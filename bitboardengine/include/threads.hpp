@@ -0,0 +1,122 @@
+#ifndef THREADS_HPP
+#define THREADS_HPP
+
+#include "search.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+constexpr int MAX_THREADS = 256;
+constexpr int SEARCHING_MOVES_SIZE = 32768;  // Power of two
+constexpr int ABDADA_DEFER_DEPTH = 3;        // Shallower nodes are not worth coordinating
+constexpr int ABDADA_DEFER_SLOTS = 16;       // Most moves deferred at one node
+
+// How the threads of a parallel search share work
+enum ParallelMode {
+    LAZY_SMP,  // Threads only share the transposition table
+    ABDADA     // Threads also defer moves another thread is already searching
+};
+
+/*
+Concurrent set of (position, move) pairs currently being searched by some thread, used by
+ABDADA to defer those moves. Lossy by design: a slot holds one key, a collision only
+overwrites it, and a wrong answer costs speed, never correctness.
+*/
+class SearchingMovesTable {
+   public:
+    SearchingMovesTable();
+
+    static uint64_t moveKey(uint64_t zobristHash, uint16_t move);
+    bool isSearching(uint64_t key) const;
+    void startSearching(uint64_t key);
+    void finishSearching(uint64_t key);
+    void clear();
+
+   private:
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+};
+
+class ThreadPool;
+
+// A persistent worker thread that sleeps between searches
+class SearchThread {
+   public:
+    SearchThread(ThreadPool& pool, int id);
+    ~SearchThread();
+
+    void startSearching();
+    void waitForSearchFinished();
+
+    std::unique_ptr<Search> search;  // Own board, key stack and move lists for this thread
+    HistoryTables history;           // Kept from one search to the next
+
+   private:
+    void idleLoop();
+
+    ThreadPool& pool;
+    int id;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool searching;
+    bool exit;
+    std::thread thread;  // Declared last so the members above exist before it starts
+};
+
+/*
+Lazy SMP thread pool. Thread 0 is the main search thread: it wakes the helpers, runs its
+own iterative deepening against the clock, then stops the helpers and picks the result.
+All threads share the transposition table and communicate only through it.
+*/
+class ThreadPool {
+   public:
+    ThreadPool();
+    ~ThreadPool();
+
+    void set(size_t count);
+    size_t size() const { return threads.size(); }
+
+    void startThinking(const BoardState& board, SearchContext& context,
+                       const SearchLimits& limits, bool printUciOutput = false);
+    void waitForSearchFinished();
+
+    uint16_t getBestMove() const { return bestMove; }
+    uint16_t getPonderMove() const { return ponderMove; }
+    int getCompletedDepth() const { return completedDepth; }
+    uint64_t nodesSearched() const;
+    void cutoffCounts(uint64_t& betaCutoffs, uint64_t& firstMoveCutoffs) const;
+    void clearHistory();
+
+    std::atomic<bool> stop;
+    std::atomic<bool> ponder;  // Cleared on `ponderhit` to start the clock
+
+   private:
+    friend class SearchThread;
+    void mainThreadSearch();
+
+    std::vector<std::unique_ptr<SearchThread>> threads;
+    uint16_t bestMove;
+    uint16_t ponderMove;
+    int completedDepth;
+    bool infinite;
+    bool printUciOutput;
+};
+
+/*
+Engine-owned state that outlives a single `go`. Every Search borrows it, so whatever
+was learned on previous moves (transposition table contents) is reused on the next
+one, and the search threads are created once and reused. Only `ucinewgame` clears it.
+*/
+struct SearchContext {
+    TranspositionTable table;
+    std::vector<uint64_t> gameHistory;  // Zobrist keys of the positions before the current one
+    ParallelMode parallelMode = LAZY_SMP;
+    int moveOverheadMs = DEFAULT_MOVE_OVERHEAD_MS;
+    PruningOptions pruning;
+    SearchingMovesTable searchingMoves;
+    ThreadPool threads;  // Last, so the threads are joined before the tables they use go away
+
+    void clear();
+};
+
+#endif // THREADS_HPP
@@ -0,0 +1,38 @@
+#ifndef TIMEMAN_HPP
+#define TIMEMAN_HPP
+
+#include <chrono>
+#include <cstdint>
+
+constexpr int DEFAULT_MOVE_OVERHEAD_MS = 30;
+constexpr int MAX_MOVE_OVERHEAD_MS = 5000;
+constexpr int DEFAULT_MOVES_TO_GO = 40;  // Moves left to plan for when the GUI doesn't say
+constexpr int TIME_CHECK_NODES = 1024;   // Nodes searched between two reads of the clock
+
+/*
+Turns the clock state of a `go` command into a time budget for one move.
+The soft limit decides whether another iteration is started, and is scaled by how
+stable the best move has been. The hard limit aborts the search in the middle of an
+iteration, and is the only one that can lose time.
+*/
+class TimeManager {
+   public:
+    void init(int timeLeftMs, int incrementMs, int movestogo, int movetimeMs, int moveOverheadMs);
+    void start();
+
+    bool isLimited() const { return hardLimitMs >= 0; }
+    int64_t elapsedMs() const;
+    bool hardLimitReached() const;
+    bool softLimitReached(int bestMoveStability) const;
+
+    int64_t getSoftLimit() const { return softLimitMs; }
+    int64_t getHardLimit() const { return hardLimitMs; }
+
+   private:
+    std::chrono::steady_clock::time_point startTime;
+    int64_t softLimitMs = -1;  // -1 means no time limit
+    int64_t hardLimitMs = -1;
+    bool fixedMoveTime = false;
+};
+
+#endif // TIMEMAN_HPP
@@ -0,0 +1,794 @@
+#include "bench.hpp"
+#include "perft.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+
+#ifdef COUNT_ALLOCATIONS
+// Heap allocations made by the current thread, counted for `allocbench` by the
+// replacements of the global operator new and delete below. Only built with
+// -DCOUNT_ALLOCATIONS, so the engine itself keeps the standard allocator.
+static thread_local uint64_t threadAllocations = 0;
+
+void* operator new(std::size_t size) {
+    ++threadAllocations;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+#endif
+
+// Positions searched by `bench`: openings, middlegames, endgames and a few tactical and
+// promotion positions. Changing this list changes the bench signature.
+static const char* BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+};
+
+// Tactical positions from Win at Chess searched by `epd` when no file is given, in EPD
+// with the solutions as `bm` in SAN
+static const char* EPD_SUITE[] = {
+    "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - bm Qg6; id \"WAC.001\";",
+    "8/7p/5k2/5p2/p1p2P2/Pr1pPK2/1P1R3P/8 b - - bm Rxb2; id \"WAC.002\";",
+    "5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w - - bm Rg3; id \"WAC.003\";",
+    "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - bm Qxh7+; id \"WAC.004\";",
+    "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - bm Qc4+; id \"WAC.005\";",
+    "7k/p7/1R5K/6r1/6p1/6P1/8/8 w - - bm Rb7; id \"WAC.006\";",
+    "rnbqkb1r/pppp1ppp/8/4P3/6n1/7P/PPPNPPP1/R1BQKBNR b KQkq - bm Ne3; id \"WAC.007\";",
+    "r4q1k/p2bR1rp/2p2Q1N/5p2/5p2/2P5/PP3PPP/R5K1 w - - bm Rf7; id \"WAC.008\";",
+    "3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b - - bm Bh2+; id \"WAC.009\";",
+    "2br2k1/2q3rn/p2NppQ1/2p1P3/Pp5R/4P3/1P3PPP/3R2K1 w - - bm Rxh7; id \"WAC.010\";",
+    "r1b1kb1r/3q1ppp/pBp1pn2/8/Np3P2/5B2/PPP3PP/R2Q1RK1 w kq - bm Bxc6; id \"WAC.011\";",
+    "4k1r1/2p3r1/1pR1p3/3pP2p/3P2qP/P4N2/1PQ4P/5R1K b - - bm Qxf3+; id \"WAC.012\";",
+    "5rk1/pp4p1/2n1p2p/2Npq3/2p5/6P1/P3P1BP/R4Q1K w - - bm Qxf8+; id \"WAC.013\";",
+    "r2rb1k1/pp1q1p1p/2n1p1p1/2bp4/5P2/PP1BPR1Q/1BPN2PP/R5K1 w - - bm Qxh7+; id \"WAC.014\";",
+    "1R6/1brk2p1/4p2p/p1P1Pp2/P7/6P1/1P4P1/2R3K1 w - - bm Rxb7; id \"WAC.015\";",
+    "r4rk1/ppp2ppp/2n5/2bqp3/8/P2PB3/1PP1NPPP/R2Q1RK1 w - - bm Nc3; id \"WAC.016\";",
+    "1k5r/pppbn1pp/4q1r1/1P3p2/2NPp3/1QP5/P4PPP/R1B1R1K1 w - - bm Ne5; id \"WAC.017\";",
+    "R7/P4k2/8/8/8/8/r7/6K1 w - - bm Rh8; id \"WAC.018\";",
+    "r1b2rk1/ppbn1ppp/4p3/1QP4q/3P4/N4N2/5PPP/R1B2RK1 w - - bm c6; id \"WAC.019\";",
+    "r2qkb1r/1ppb1ppp/p7/4p3/P1Q1P3/2P5/5PPP/R1B2KNR b kq - bm Bb5; id \"WAC.020\";",
+};
+
+// Positions searched by the SMP scaling benchmark
+static const char* SMP_BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+/**
+ * Measures how much of the transposition table survives from one move to the next.
+ *
+ * - Plays `plies` moves of self-play from the starting position at `movetimeMs` per move.
+ * - Every move is searched twice: once with the persistent engine context (warm), and once
+ *   with a brand-new context, which is how every `go` behaved before the context existed (cold).
+ * - Reports the TT hit rate (hits / probes in negamax) and the cutoff rate (hits deep enough
+ *   to return without searching / probes) of both runs per ply, and their averages over the
+ *   second and later moves, where reuse is possible.
+ *
+ * @param movetimeMs The time limit in milliseconds for each search.
+ * @param plies The number of half-moves to play.
+ */
+void ttReuseBench(int movetimeMs, int plies) {
+    BoardState board;
+    SearchContext warmContext;
+    SearchLimits limits;
+    limits.movetime = movetimeMs;
+    double warmHits = 0, coldHits = 0, warmCutoffs = 0, coldCutoffs = 0;
+    int measured = 0;
+
+    std::cout << std::setw(6) << "Ply" << std::setw(10) << "Move" << std::setw(14) << "Warm hit %"
+              << std::setw(14) << "Cold hit %" << std::setw(14) << "Warm cut %" << std::setw(14)
+              << "Cold cut %" << std::endl;
+    std::cout << std::string(72, '-') << std::endl;
+
+    for (int ply = 1; ply <= plies; ++ply) {
+        Search warm(board, warmContext, limits);
+        uint16_t move = warm.iterativeDeepening();
+
+        SearchContext coldContext;
+        coldContext.gameHistory = warmContext.gameHistory;
+        Search cold(board, coldContext, limits);
+        cold.iterativeDeepening();
+
+        const SearchStats& w = warm.getStats();
+        const SearchStats& c = cold.getStats();
+        double warmHitRate = w.ttProbes ? 100.0 * w.ttHits / w.ttProbes : 0.0;
+        double coldHitRate = c.ttProbes ? 100.0 * c.ttHits / c.ttProbes : 0.0;
+        double warmCutRate = w.ttProbes ? 100.0 * w.ttCutoffs / w.ttProbes : 0.0;
+        double coldCutRate = c.ttProbes ? 100.0 * c.ttCutoffs / c.ttProbes : 0.0;
+
+        std::cout << std::setw(6) << ply << std::setw(10) << moveToString(move) << std::fixed
+                  << std::setprecision(2) << std::setw(14) << warmHitRate << std::setw(14)
+                  << coldHitRate << std::setw(14) << warmCutRate << std::setw(14) << coldCutRate
+                  << std::endl;
+
+        if (ply > 1) {
+            warmHits += warmHitRate;
+            coldHits += coldHitRate;
+            warmCutoffs += warmCutRate;
+            coldCutoffs += coldCutRate;
+            measured++;
+        }
+        if (move == 0) break;  // Game over
+        warmContext.gameHistory.push_back(board.getZobristHash());
+        applyMove(board, move);
+    }
+
+    if (measured > 0) {
+        std::cout << std::string(72, '-') << std::endl;
+        std::cout << std::setw(16) << "Avg (ply >= 2)" << std::setw(14) << warmHits / measured
+                  << std::setw(14) << coldHits / measured << std::setw(14)
+                  << warmCutoffs / measured << std::setw(14) << coldCutoffs / measured
+                  << std::endl;
+    }
+}
+
+/**
+ * Searches every SMP benchmark position to a fixed depth with the context's current
+ * thread count and parallel mode, starting each search from an empty table.
+ *
+ * @param context The engine context to search with.
+ * @param limits The limits of each search.
+ * @param nodes Set to the total number of nodes searched by all threads.
+ * @return The total time to depth in seconds.
+ */
+static double timeSmpBenchPositions(SearchContext& context, const SearchLimits& limits,
+                                    uint64_t& nodes) {
+    nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const char* fen : SMP_BENCH_FENS) {
+        BoardState board = parseFEN(fen);
+        context.clear();
+        context.gameHistory.clear();
+        context.threads.startThinking(board, context, limits);
+        context.threads.waitForSearchFinished();
+        nodes += context.threads.nodesSearched();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Compares how the parallel search modes scale with the number of threads.
+ *
+ * - Searches every benchmark position to a fixed `depth` single-threaded, then with
+ *   2 ... `maxThreads` threads in each mode (Lazy SMP and ABDADA). The table is cleared
+ *   before each search so every run starts cold.
+ * - Reports the total time to depth, total nodes (all threads), NPS, the time-to-depth
+ *   speedup over the single-threaded run, and the search overhead: the extra nodes
+ *   searched relative to the single-threaded run.
+ *
+ * @param depth The depth every position is searched to.
+ * @param maxThreads The largest thread count to measure.
+ */
+void smpScalingBench(int depth, int maxThreads) {
+    SearchContext context;
+    SearchLimits limits;
+    limits.depth = depth;
+
+    std::cout << std::setw(9) << "Mode" << std::setw(9) << "Threads" << std::setw(12)
+              << "Time (s)" << std::setw(14) << "Nodes" << std::setw(14) << "NPS"
+              << std::setw(10) << "Speedup" << std::setw(12) << "Overhead %" << std::endl;
+    std::cout << std::string(80, '-') << std::endl;
+
+    uint64_t baseNodes = 0;
+    context.threads.set(1);
+    double baseSeconds = timeSmpBenchPositions(context, limits, baseNodes);
+
+    const ParallelMode modes[] = {LAZY_SMP, ABDADA};
+    for (ParallelMode mode : modes) {
+        context.parallelMode = mode;
+        for (int threads = 1; threads <= maxThreads; ++threads) {
+            uint64_t nodes = baseNodes;
+            double seconds = baseSeconds;
+            if (threads > 1) {
+                context.threads.set(threads);
+                seconds = timeSmpBenchPositions(context, limits, nodes);
+            } else if (mode != modes[0]) {
+                continue;  // The single-threaded baseline is the same for every mode
+            }
+
+            std::cout << std::setw(9) << (threads == 1 ? "-" : mode == ABDADA ? "ABDADA" : "LazySMP")
+                      << std::setw(9) << threads << std::fixed << std::setprecision(3)
+                      << std::setw(12) << seconds << std::setw(14) << nodes << std::setw(14)
+                      << uint64_t(nodes / std::max(seconds, 1e-9)) << std::setprecision(2)
+                      << std::setw(10) << baseSeconds / std::max(seconds, 1e-9) << std::setw(12)
+                      << 100.0 * (double(nodes) / std::max<uint64_t>(baseNodes, 1) - 1.0)
+                      << std::endl;
+        }
+    }
+}
+
+/**
+ * Plays a self-play game between two engines and records the search depth reached by
+ * the first (white) engine on each of its moves.
+ *
+ * - Both engines search `movetimeMs` per move on their own context.
+ * - When `ponder` is set, white searches the expected reply during black's time. On a
+ *   ponder hit it continues that search on its own clock, otherwise it stops it and
+ *   searches the actual position from scratch.
+ *
+ * @param movetimeMs The time limit in milliseconds for each move.
+ * @param plies The number of half-moves to play.
+ * @param ponder Whether white ponders.
+ * @param ponderHits Set to the number of moves where white's ponder move was played.
+ * @return White's completed depth on each of its moves.
+ */
+static std::vector<int> playPonderGame(int movetimeMs, int plies, bool ponder, int& ponderHits) {
+    BoardState board;
+    SearchContext white, black;
+    SearchLimits limits;
+    limits.movetime = movetimeMs;
+    std::vector<uint64_t> history;
+    std::vector<int> depths;
+    bool pondering = false;
+    uint16_t ponderMove = 0;
+    ponderHits = 0;
+
+    for (int ply = 0; ply < plies; ++ply) {
+        uint16_t move = 0;
+        if (board.getTurn()) {
+            if (pondering) {
+                white.threads.ponder = false;  // Hit: carry on with the pondered search
+            } else {
+                white.gameHistory = history;
+                white.threads.startThinking(board, white, limits);
+            }
+            white.threads.waitForSearchFinished();
+            move = white.threads.getBestMove();
+            depths.push_back(white.threads.getCompletedDepth());
+            ponderMove = white.threads.getPonderMove();
+            pondering = false;
+        } else {
+            if (ponder && ponderMove) {
+                // Ponder on the position after the expected reply, as a GUI would set it up
+                BoardState ponderBoard = board;
+                white.gameHistory = history;
+                white.gameHistory.push_back(ponderBoard.getZobristHash());
+                applyMove(ponderBoard, ponderMove);
+                SearchLimits ponderLimits = limits;
+                ponderLimits.ponder = true;
+                white.threads.startThinking(ponderBoard, white, ponderLimits);
+                pondering = true;
+            }
+            black.gameHistory = history;
+            black.threads.startThinking(board, black, limits);
+            black.threads.waitForSearchFinished();
+            move = black.threads.getBestMove();
+            if (pondering && move == ponderMove) {
+                ponderHits++;
+            } else if (pondering) {
+                white.threads.stop = true;  // Miss: throw the pondered search away
+                white.threads.waitForSearchFinished();
+                pondering = false;
+            }
+        }
+        if (move == 0) break;  // Game over
+        history.push_back(board.getZobristHash());
+        applyMove(board, move);
+    }
+    if (pondering) {
+        white.threads.stop = true;
+        white.threads.waitForSearchFinished();
+    }
+    return depths;
+}
+
+// Mean of a list of search depths
+static double averageDepth(const std::vector<int>& depths) {
+    double sum = 0;
+    for (int depth : depths) sum += depth;
+    return depths.empty() ? 0.0 : sum / depths.size();
+}
+
+/**
+ * Measures the extra search depth pondering gives per move in self-play.
+ *
+ * - Plays the same self-play game setup twice, once with the white engine pondering and
+ *   once without, and compares white's average completed depth per move.
+ * - The games can diverge, so the result is an average over different positions; use
+ *   enough plies for it to be meaningful. Both engines run on the same machine, so on a
+ *   single core pondering also slows the opponent down.
+ *
+ * @param movetimeMs The time limit in milliseconds for each move.
+ * @param plies The number of half-moves to play in each game.
+ */
+void ponderBench(int movetimeMs, int plies) {
+    int ponderHits = 0, ignored = 0;
+    std::vector<int> without = playPonderGame(movetimeMs, plies, false, ignored);
+    std::vector<int> with = playPonderGame(movetimeMs, plies, true, ponderHits);
+
+    double hitRate = with.size() > 1 ? 100.0 * ponderHits / (with.size() - 1) : 0.0;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Moves searched        " << with.size() << std::endl;
+    std::cout << "Ponder hit rate %     " << hitRate << std::endl;
+    std::cout << "Avg depth, no ponder  " << averageDepth(without) << std::endl;
+    std::cout << "Avg depth, ponder     " << averageDepth(with) << std::endl;
+    std::cout << "Depth gain per move   " << averageDepth(with) - averageDepth(without) << std::endl;
+}
+
+/**
+ * The standard speed and behaviour benchmark, run between builds.
+ *
+ * - Searches every position of BENCH_FENS to a fixed depth, each from an empty table.
+ * - Prints the share of beta cutoffs that came on the first move searched, a measure of
+ *   move ordering.
+ * - Prints the total nodes, elapsed time and NPS, and a signature: an FNV-1a hash of the
+ *   node count and best move of every position. Any change in search behaviour changes
+ *   the signature, while a pure speed-up leaves it alone. It is only reproducible with
+ *   one thread.
+ *
+ * @param depth The depth every position is searched to.
+ * @param threads The number of search threads.
+ * @param hashMB The transposition table size in megabytes.
+ * @param pruning The forward pruning techniques to search with.
+ */
+void runBench(int depth, int threads, int hashMB, const PruningOptions& pruning) {
+    depth = std::max(1, std::min(depth, MAX_SEARCH_PLY));
+    threads = std::max(1, std::min(threads, MAX_THREADS));
+    hashMB = std::max(1, std::min(hashMB, TT_MAX_SIZE_MB));
+
+    SearchContext context;
+    context.table.resize(hashMB);
+    context.threads.set(threads);
+    context.pruning = pruning;
+    SearchLimits limits;
+    limits.depth = depth;
+
+    uint64_t totalNodes = 0, totalCutoffs = 0, totalFirstMoveCutoffs = 0;
+    uint64_t signature = 0xcbf29ce484222325ULL;  // FNV-1a offset basis
+    int positions = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < positions; ++i) {
+        BoardState board = parseFEN(BENCH_FENS[i]);
+        context.clear();
+        context.gameHistory.clear();
+        context.threads.startThinking(board, context, limits);
+        context.threads.waitForSearchFinished();
+
+        uint64_t nodes = context.threads.nodesSearched();
+        uint16_t move = context.threads.getBestMove();
+        totalNodes += nodes;
+        uint64_t cutoffs, firstMoveCutoffs;
+        context.threads.cutoffCounts(cutoffs, firstMoveCutoffs);
+        totalCutoffs += cutoffs;
+        totalFirstMoveCutoffs += firstMoveCutoffs;
+        uint64_t values[] = {nodes, move};
+        for (uint64_t value : values) {
+            for (int byte = 0; byte < 8; ++byte) {
+                signature = (signature ^ ((value >> (8 * byte)) & 0xFF)) * 0x100000001b3ULL;
+            }
+        }
+
+        std::cout << "Position " << std::setw(2) << i + 1 << "/" << positions << std::setw(8)
+                  << moveToString(move) << std::setw(12) << nodes << std::endl;
+    }
+
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::string(32, '=') << std::endl;
+    std::cout << "Total time (ms) : " << uint64_t(seconds * 1000) << std::endl;
+    std::cout << "Nodes searched  : " << totalNodes << std::endl;
+    std::cout << "Nodes/second    : " << uint64_t(totalNodes / std::max(seconds, 1e-9)) << std::endl;
+    std::cout << "First-move cuts : " << std::fixed << std::setprecision(1)
+              << 100.0 * totalFirstMoveCutoffs / std::max<uint64_t>(1, totalCutoffs) << "%"
+              << std::defaultfloat << std::endl;
+    std::cout << "Signature       : " << std::hex << signature << std::dec << std::endl;
+}
+
+/**
+ * Counts the heap allocations made while generating moves and searching.
+ *
+ * - Perft of the start position exercises move generation and make/unmake alone.
+ * - Every BENCH_FENS position is then searched to a fixed depth on the calling thread,
+ *   so the count covers the search and nothing else. Setting up the search is left out.
+ * - Nodes should not allocate at all: what remains is per iteration work at the root,
+ *   such as growing the root PV.
+ * - Needs a build with -DCOUNT_ALLOCATIONS; otherwise nothing is counted.
+ *
+ * @param depth The depth every position is searched to.
+ */
+void allocBench(int depth) {
+#ifndef COUNT_ALLOCATIONS
+    (void)depth;
+    std::cout << "allocbench needs a build with -DCOUNT_ALLOCATIONS" << std::endl;
+#else
+    depth = std::max(1, std::min(depth, MAX_SEARCH_PLY));
+
+    BoardState startBoard = parseFEN(BENCH_FENS[0]);
+    uint64_t before = threadAllocations;
+    uint64_t perftNodes = perft(startBoard, 5);
+    std::cout << "Perft 5 allocations : " << threadAllocations - before << " over " << perftNodes
+              << " leaves" << std::endl;
+
+    SearchContext context;
+    SearchLimits limits;
+    limits.depth = depth;
+
+    uint64_t totalNodes = 0, totalAllocations = 0;
+    int positions = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    for (int i = 0; i < positions; ++i) {
+        BoardState board = parseFEN(BENCH_FENS[i]);
+        context.table.clear();
+        Search search(board, context, limits);
+
+        before = threadAllocations;
+        search.iterativeDeepening();
+        totalAllocations += threadAllocations - before;
+        totalNodes += search.getStats().nodes;
+    }
+
+    std::cout << "Search allocations  : " << totalAllocations << " over " << totalNodes
+              << " nodes" << std::endl;
+    std::cout << "Allocations/node    : " << std::fixed << std::setprecision(6)
+              << double(totalAllocations) / std::max<uint64_t>(1, totalNodes) << std::endl;
+#endif
+}
+
+/**
+ * Measures make/unmake throughput on its own.
+ *
+ * - Applies and undoes every legal move of every BENCH_FENS position, `rounds` times over.
+ * - Move generation happens once per position, outside the timed loop.
+ *
+ * @param rounds How many times every move is made and unmade.
+ */
+void makeUnmakeBench(int rounds) {
+    rounds = std::max(1, rounds);
+    int positions = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    uint64_t moves = 0;
+    uint64_t checksum = 0;  // Keeps the loop from being optimised away
+    double seconds = 0;
+
+    for (int i = 0; i < positions; ++i) {
+        BoardState board = parseFEN(BENCH_FENS[i]);
+        MoveList legalMoves = allLegalMoves(board);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (uint16_t move : legalMoves) {
+                MoveUndo undoData = applyMove(board, move);
+                checksum += board.getZobristHash();
+                undoMove(board, undoData);
+            }
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        moves += uint64_t(rounds) * legalMoves.size();
+    }
+
+    std::cout << "Moves made/unmade   : " << moves << std::endl;
+    std::cout << "Total time (ms)     : " << uint64_t(seconds * 1000) << std::endl;
+    std::cout << "Make+unmake/second  : " << uint64_t(moves / std::max(seconds, 1e-9))
+              << std::endl;
+    std::cout << "Checksum            : " << std::hex << checksum << std::dec << std::endl;
+}
+
+/**
+ * Measures quiescence search speed on its own.
+ *
+ * - Runs QSearch with a full window on every position one move away from a BENCH_FENS
+ *   position, `rounds` times each, and reports the quiescence nodes per second.
+ * - The table is cleared before every round, so each one searches from scratch rather
+ *   than reading the last one's result back. Clearing it and setting up each Search are
+ *   left out of the timing.
+ *
+ * @param rounds How many times each position is searched.
+ */
+void qsearchBench(int rounds) {
+    rounds = std::max(1, rounds);
+    SearchContext context;
+    context.table.resize(1);  // Cheap to clear
+    SearchLimits limits;
+    uint64_t nodes = 0;
+    double seconds = 0;
+
+    int positions = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    for (int i = 0; i < positions; ++i) {
+        BoardState board = parseFEN(BENCH_FENS[i]);
+        MoveList legalMoves = allLegalMoves(board);
+        for (uint16_t move : legalMoves) {
+            MoveUndo undoData = applyMove(board, move);
+            Search search(board, context, limits);
+
+            for (int round = 0; round < rounds; ++round) {
+                context.table.clear();
+                auto start = std::chrono::steady_clock::now();
+                search.quiescence();
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                               .count();
+            }
+            nodes += search.getStats().nodes;
+            undoMove(board, undoData);
+        }
+    }
+
+    std::cout << "QSearch nodes       : " << nodes << std::endl;
+    std::cout << "Total time (ms)     : " << uint64_t(seconds * 1000) << std::endl;
+    std::cout << "QSearch nodes/second: " << uint64_t(nodes / std::max(seconds, 1e-9))
+              << std::endl;
+}
+
+/**
+ * Measures the cost of ordering the moves of a node.
+ *
+ * - Runs on every position one move away from a BENCH_FENS position, `rounds` times each.
+ * - Full sort: generating every legal move and ordering them all with `orderMoves`, which
+ *   is what every node paid before the move picker.
+ * - First move: what the move picker does before handing out its first move, all a node
+ *   pays when that move cuts off.
+ * - All moves: the move picker handing out every move, the worst case for a node.
+ *
+ * @param rounds How many times each position is ordered.
+ */
+void moveOrderBench(int rounds) {
+    rounds = std::max(1, rounds);
+    uint64_t nodes = 0;
+    uint64_t checksum = 0;  // Keeps the loops from being optimised away
+    double sortSeconds = 0, firstSeconds = 0, allSeconds = 0;
+
+    int positions = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    for (int i = 0; i < positions; ++i) {
+        BoardState board = parseFEN(BENCH_FENS[i]);
+        MoveList legalMoves = allLegalMoves(board);
+        for (uint16_t move : legalMoves) {
+            MoveUndo undoData = applyMove(board, move);
+
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                MoveList moves = allLegalMoves(board);
+                orderMoves(board, moves);
+                checksum += moves.empty() ? 0 : moves[0].move;
+            }
+            auto sorted = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                MovePicker picker(board);
+                checksum += picker.nextMove();
+            }
+            auto first = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                MovePicker picker(board);
+                while (uint16_t next = picker.nextMove()) checksum += next;
+            }
+            auto all = std::chrono::steady_clock::now();
+
+            sortSeconds += std::chrono::duration<double>(sorted - start).count();
+            firstSeconds += std::chrono::duration<double>(first - sorted).count();
+            allSeconds += std::chrono::duration<double>(all - first).count();
+            nodes += rounds;
+            undoMove(board, undoData);
+        }
+    }
+
+    std::cout << "Nodes ordered          : " << nodes << std::endl;
+    std::cout << "Full sort (ns/node)    : " << uint64_t(sortSeconds * 1e9 / nodes) << std::endl;
+    std::cout << "Picker first (ns/node) : " << uint64_t(firstSeconds * 1e9 / nodes) << std::endl;
+    std::cout << "Picker all (ns/node)   : " << uint64_t(allSeconds * 1e9 / nodes) << std::endl;
+    std::cout << "Checksum               : " << std::hex << checksum << std::dec << std::endl;
+}
+
+/**
+ * Writes a legal move in standard algebraic notation, without check or mate marks.
+ *
+ * - A piece move names the file, the rank or both of its origin only when another piece
+ *   of the same kind can reach the same square.
+ *
+ * @param board The position the move is played in.
+ * @param move A legal move in this position.
+ * @param legalMoves Every legal move in this position.
+ * @return The move in SAN, such as "Nbd7", "exd5", "e8=Q" or "O-O".
+ */
+static std::string moveToSan(const BoardState& board, uint16_t move, const MoveList& legalMoves) {
+    static const char PIECE_LETTERS[] = "PNBRQK";
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    if (special == CASTLING_KINGSIDE) return "O-O";
+    if (special == CASTLING_QUEENSIDE) return "O-O-O";
+
+    int pieceType = board.pieceOn(fromSquare) % 6;
+    bool capture = board.pieceOn(toSquare) != NO_PIECE || special == EN_PASSANT;
+    std::string from = squareToAlgebraic(fromSquare);
+    std::string san;
+    if (pieceType == WHITE_PAWNS) {
+        if (capture) san += from[0];
+    } else {
+        san += PIECE_LETTERS[pieceType];
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        for (uint16_t other : legalMoves) {
+            int otherFrom, otherTo, otherSpecial;
+            decodeMove(other, otherFrom, otherTo, otherSpecial);
+            if (other == move || otherTo != toSquare || board.pieceOn(otherFrom) % 6 != pieceType) {
+                continue;
+            }
+            ambiguous = true;
+            sameFile |= otherFrom % 8 == fromSquare % 8;
+            sameRank |= otherFrom / 8 == fromSquare / 8;
+        }
+        if (ambiguous && (!sameFile || sameRank)) san += from[0];
+        if (ambiguous && sameFile) san += from[1];
+    }
+    if (capture) san += 'x';
+    san += squareToAlgebraic(toSquare);
+
+    switch (special) {
+        case PROMOTION_QUEEN: san += "=Q"; break;
+        case PROMOTION_KNIGHT: san += "=N"; break;
+        case PROMOTION_ROOK: san += "=R"; break;
+        case PROMOTION_BISHOP: san += "=B"; break;
+        default: break;
+    }
+    return san;
+}
+
+/**
+ * Reads the position and the solution of one EPD record.
+ *
+ * - Moves of the `bm` and `am` operations may be in SAN or in UCI notation; check marks
+ *   and annotations are ignored.
+ *
+ * @param line The EPD record.
+ * @param board Set to the position.
+ * @param bestMoves Set to the moves of the `bm` operation.
+ * @param avoidMoves Set to the moves of the `am` operation.
+ * @param id Set to the `id` operation, or left as it is when there is none.
+ * @return False if the record has no solution, or names a move that is not legal.
+ */
+static bool parseEpd(const std::string& line, BoardState& board, std::vector<uint16_t>& bestMoves,
+                     std::vector<uint16_t>& avoidMoves, std::string& id) {
+    std::istringstream iss(line);
+    std::string fields[4];
+    for (std::string& field : fields) {
+        if (!(iss >> field)) return false;
+    }
+    board = parseFEN(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1");
+    MoveList legalMoves = allLegalMoves(board);
+
+    std::string operation;
+    bestMoves.clear();
+    avoidMoves.clear();
+    while (std::getline(iss >> std::ws, operation, ';')) {
+        std::istringstream operands(operation);
+        std::string opcode, operand;
+        operands >> opcode;
+        if (opcode == "id") {
+            std::getline(operands >> std::ws, id);
+            id.erase(std::remove(id.begin(), id.end(), '"'), id.end());
+            continue;
+        }
+        if (opcode != "bm" && opcode != "am") continue;
+        while (operands >> operand) {
+            operand.erase(operand.find_last_not_of("+#!?") + 1);
+            uint16_t found = 0;
+            for (uint16_t move : legalMoves) {
+                if (moveToSan(board, move, legalMoves) == operand || moveToString(move) == operand) {
+                    found = move;
+                }
+            }
+            if (!found) return false;
+            (opcode == "bm" ? bestMoves : avoidMoves).push_back(found);
+        }
+    }
+    return !bestMoves.empty() || !avoidMoves.empty();
+}
+
+/**
+ * Measures how many positions of a tactical test suite the search solves, and at what cost.
+ *
+ * - A position is solved when the move played is one of its `bm` moves and none of its
+ *   `am` moves.
+ * - Every position is searched from an empty table, to a fixed depth or for a fixed time.
+ * - Records that cannot be read, or whose solution is not a legal move, are reported and
+ *   skipped.
+ *
+ * @param depth The depth every position is searched to.
+ * @param movetimeMs The time every position is searched for, or 0 to search to the depth.
+ * @param file The EPD file to read, or empty for the built-in EPD_SUITE.
+ * @param pruning The pruning, reduction and extension techniques to search with.
+ */
+void epdBench(int depth, int movetimeMs, const std::string& file, const PruningOptions& pruning) {
+    std::vector<std::string> records;
+    if (file.empty()) {
+        records.assign(std::begin(EPD_SUITE), std::end(EPD_SUITE));
+    } else {
+        std::ifstream input(file);
+        if (!input) {
+            std::cerr << "Error: Cannot open " << file << std::endl;
+            return;
+        }
+        std::string line;
+        while (std::getline(input, line)) {
+            if (!line.empty()) records.push_back(line);
+        }
+    }
+
+    SearchContext context;
+    context.pruning = pruning;
+    SearchLimits limits;
+    limits.depth = std::max(1, std::min(depth, MAX_SEARCH_PLY));
+    if (movetimeMs > 0) {
+        limits.depth = MAX_SEARCH_PLY;
+        limits.movetime = movetimeMs;
+    }
+
+    int solved = 0, searched = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records.size(); ++i) {
+        BoardState board;
+        std::vector<uint16_t> bestMoves, avoidMoves;
+        std::string id = "#" + std::to_string(i + 1);
+        if (!parseEpd(records[i], board, bestMoves, avoidMoves, id)) {
+            std::cerr << "Error: Skipping unreadable EPD record: " << records[i] << std::endl;
+            continue;
+        }
+
+        context.clear();
+        context.gameHistory.clear();
+        context.threads.startThinking(board, context, limits);
+        context.threads.waitForSearchFinished();
+
+        uint16_t move = context.threads.getBestMove();
+        uint64_t nodes = context.threads.nodesSearched();
+        bool good = (bestMoves.empty() ||
+                     std::find(bestMoves.begin(), bestMoves.end(), move) != bestMoves.end()) &&
+                    std::find(avoidMoves.begin(), avoidMoves.end(), move) == avoidMoves.end();
+        solved += good;
+        searched++;
+        totalNodes += nodes;
+        std::cout << std::left << std::setw(12) << id << std::right << std::setw(8)
+                  << moveToString(move) << std::setw(8) << (good ? "ok" : "--") << std::setw(12)
+                  << nodes << std::endl;
+    }
+
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::string(32, '=') << std::endl;
+    std::cout << "Solved          : " << solved << "/" << searched << std::endl;
+    std::cout << "Total time (ms) : " << uint64_t(seconds * 1000) << std::endl;
+    std::cout << "Nodes searched  : " << totalNodes << std::endl;
+}
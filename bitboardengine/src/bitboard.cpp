@@ -1,4 +1,5 @@
 #include "bitboard.hpp"
+#include "movegen.hpp"
 
 
 uint64_t zobristTable[12][64];
@@ -85,6 +86,7 @@ std::string bitboardToBinaryString(uint64_t bitboard) {
 // Constructor for BoardState
 BoardState::BoardState()
     : bitboards{},  // Initialize all bitboards to 0
+      mailbox{},
       white_occupancy(0),
       black_occupancy(0),
       all_occupancy(0),
@@ -92,7 +94,9 @@ BoardState::BoardState()
       castling_rights(0b1111),  // All castling rights enabled (KQkq)
       is_white_turn(true),      // White moves first
       halfmove_clock(0),        // No halfmoves at the start
-      fullmove_number(1)        // First move of the game
+      fullmove_number(1),       // First move of the game
+      states{},
+      stateIndex(0)
 {
     // Initialize the starting positions of pieces using bitboards
     bitboards[WHITE_PAWNS] = 0x000000000000FF00;
@@ -111,6 +115,56 @@ BoardState::BoardState()
 
     // Calculate occupancies
     updateOccupancy();
+
+    mailbox.fill(NO_PIECE);
+    for (int pieceType = WHITE_PAWNS; pieceType <= BLACK_KINGS; ++pieceType) {
+        uint64_t pieceBB = bitboards[pieceType];
+        while (pieceBB) {
+            mailbox[__builtin_ctzll(pieceBB)] = pieceType;
+            pieceBB &= pieceBB - 1;
+        }
+    }
+    updateStateInfo(*this);
+}
+
+/**
+ * Copies a board without its StateInfo history.
+ *
+ * - Only the current StateInfo is copied; the earlier slots would only be read by
+ *   unmaking moves made before the copy, which copies never do.
+ * - Keeps copies cheap: boards are passed around by value, and the whole StateInfo
+ *   ring buffer is several kilobytes.
+ *
+ * @param other The board to copy.
+ */
+BoardState::BoardState(const BoardState& other) { copyFrom(other); }
+
+/**
+ * Assigns a board without its StateInfo history, like the copy constructor.
+ *
+ * @param other The board to copy.
+ * @return This board.
+ */
+BoardState& BoardState::operator=(const BoardState& other) {
+    if (this != &other) copyFrom(other);
+    return *this;
+}
+
+// Copies the position and its current StateInfo; shared by copy construction and assignment
+void BoardState::copyFrom(const BoardState& other) {
+    bitboards = other.bitboards;
+    mailbox = other.mailbox;
+    white_occupancy = other.white_occupancy;
+    black_occupancy = other.black_occupancy;
+    all_occupancy = other.all_occupancy;
+    en_passant_square = other.en_passant_square;
+    castling_rights = other.castling_rights;
+    is_white_turn = other.is_white_turn;
+    halfmove_clock = other.halfmove_clock;
+    fullmove_number = other.fullmove_number;
+    zobrist_hash = other.zobrist_hash;
+    stateIndex = other.stateIndex;
+    states[stateIndex] = other.states[stateIndex];
 }
 
 /**
@@ -119,20 +173,33 @@ BoardState::BoardState()
  * - Replaces the old bitboard with the new one.
  * - Updates the white and black occupancy bitboards accordingly.
  * - Calls `updateOccupancy()` to refresh the overall occupancy bitboard.
- * - Throws an exception if `pieceType` is out of the valid range (0-11).
+ * - Updates the mailbox for the squares that changed. A square that was already taken
+ *   over by another piece (a capture, where the mover is placed before the captured piece
+ *   is removed) keeps its new owner.
+ * - Only checks that `pieceType` is in range (0-11) in debug builds.
+ * - Make/unmake use `putPiece`, `removePiece` and `movePiece` instead.
  *
  * @param pieceType The index of the piece type (0-5 for white, 6-11 for black).
  * @param newBitboard The updated bitboard for the given piece type.
  */
 void BoardState::updateBitboard(int pieceType, uint64_t newBitboard) {
-    if (pieceType < 0 || pieceType >= 12) {
-        throw std::invalid_argument("Invalid pieceType in updateBitboard");
-        return;
-    }
+    assert(pieceType >= 0 && pieceType < 12);
 
     uint64_t oldBitboard = bitboards[pieceType];  // Store the old bitboard
     bitboards[pieceType] = newBitboard;           // Update the piece's bitboard
 
+    uint64_t removed = oldBitboard & ~newBitboard;
+    while (removed) {
+        int square = __builtin_ctzll(removed);
+        if (mailbox[square] == pieceType) mailbox[square] = NO_PIECE;
+        removed &= removed - 1;
+    }
+    uint64_t added = newBitboard & ~oldBitboard;
+    while (added) {
+        mailbox[__builtin_ctzll(added)] = pieceType;
+        added &= added - 1;
+    }
+
     // Update the occupancy bitboards based on the difference in bitboards
     if (pieceType < 6) {                                     // White piece
         white_occupancy ^= oldBitboard;  // Remove old
@@ -144,23 +211,6 @@ void BoardState::updateBitboard(int pieceType, uint64_t newBitboard) {
     updateOccupancy();
 }
 
-/**
- * Retrieves the bitboard for a specific piece type.
- *
- * - Each piece type (0-11) corresponds to a specific bitboard.
- * - Throws an exception if `pieceType` is out of range.
- *
- * @param pieceType The index of the piece type (0-11).
- * @return The bitboard representing the given piece type.
- */
-uint64_t BoardState::getBitboard(int pieceType) const {
-    if (pieceType < 0 || pieceType >= 12) {
-        throw std::invalid_argument("Invalid pieceType in getBitboard.");
-        return 0;
-    }
-    return bitboards[pieceType];
-}
-
 /**
  * Sets the occupancy bitboards for white and black pieces.
  *
@@ -412,6 +462,7 @@ void BoardState::setZobristHash(uint64_t zobrist){ zobrist_hash = zobrist; }
  */
 bool operator==(const BoardState& lhs, const BoardState& rhs) {
     return lhs.bitboards == rhs.bitboards &&
+           lhs.mailbox == rhs.mailbox &&
            lhs.white_occupancy == rhs.white_occupancy &&
            lhs.black_occupancy == rhs.black_occupancy &&
            lhs.all_occupancy == rhs.all_occupancy &&
@@ -601,9 +652,9 @@ BoardState parseFEN(const std::string& fen) {
     fenStream >> piecePlacement >> sideToMove >> castlingRights >> enPassant >> halfmoveClock >>
         fullmoveNumber;
 
-    // Initialize bitboards for all pieces
-    for (int i = 0; i < 12; ++i) {
-        board.updateBitboard(i, 0);
+    // Clear the start position the constructor set up
+    for (int square = 0; square < 64; ++square) {
+        if (board.pieceOn(square) != NO_PIECE) board.removePiece(square);
     }
 
     int square = 56;  // Start from top-left (a8), which is bit 56
@@ -614,12 +665,7 @@ BoardState parseFEN(const std::string& fen) {
             square -= 16;  // Move to the next rank (up one row in FEN, down in bitboard)
         } else {
             int pieceType = charToPieceIndex(ch);  // Get piece index
-            uint64_t currentBitboard = board.getBitboard(pieceType);
-
-            // Add the piece to the piece bitboard
-            uint64_t newBitboard = (1ULL << square);
-            newBitboard |= currentBitboard;
-            board.updateBitboard(pieceType, newBitboard);
+            board.putPiece(pieceType, square);
             square++;
         }
     }
@@ -641,6 +687,7 @@ BoardState parseFEN(const std::string& fen) {
     // Calculate and set Zobrist hash
     uint64_t zobristHash = computeZobristHash(board);
     board.setZobristHash(zobristHash);
+    updateStateInfo(board);
     return board;
 }
 
@@ -717,79 +764,235 @@ uint64_t computeZobristHash(const BoardState& board) {
 }
 
 /**
- * Updates the transposition table with a new entry.
+ * Packs the fields of a transposition table slot into a single 64-bit word.
  *
- * - Only updates if the new depth is greater than the stored depth.
- * - Stores the best move, evaluation, depth, and evaluation type.
+ * - Bits [0-15]: best move
+ * - Bits [16-23]: depth + TT_DEPTH_OFFSET (0 means the slot is empty)
+ * - Bits [24-31]: generation in the high bits, bound type in the low bits
+ * - Bits [32-63]: evaluation as a signed 32-bit value
+ */
+static inline uint64_t packTTData(uint16_t move, int depth8, uint8_t genBound8, int evaluation) {
+    return uint64_t(move) | (uint64_t(depth8 & 0xFF) << 16) | (uint64_t(genBound8) << 24) |
+           (uint64_t(uint32_t(int32_t(evaluation))) << 32);
+}
+
+static inline uint16_t ttMove(uint64_t data) { return uint16_t(data & 0xFFFF); }
+static inline int ttDepth8(uint64_t data) { return int((data >> 16) & 0xFF); }
+static inline uint8_t ttGenBound8(uint64_t data) { return uint8_t((data >> 24) & 0xFF); }
+static inline int ttEvaluation(uint64_t data) { return int(int32_t(uint32_t(data >> 32))); }
+
+// Folds the data word into the stored key so torn slots fail verification
+static inline uint32_t ttKeyCheck(uint64_t data) { return uint32_t(data) ^ uint32_t(data >> 32); }
+
+/**
+ * Constructs a transposition table of (at most) the given size in megabytes.
+ *
+ * @param sizeMB The requested size of the table in megabytes.
+ */
+TranspositionTable::TranspositionTable(size_t sizeMB)
+    : clusterCount(0), clusterMask(0), generation8(0) {
+    resize(sizeMB);
+}
+
+/**
+ * Reallocates the table to the largest power-of-two cluster count that fits in `sizeMB`.
+ *
+ * - All stored entries are discarded.
+ * - The table is allocated once here and never grows during search.
+ * - Must not be called while a search is running.
+ *
+ * @param sizeMB The requested size of the table in megabytes (at least 1).
+ */
+void TranspositionTable::resize(size_t sizeMB) {
+    sizeMB = std::max<size_t>(1, std::min<size_t>(sizeMB, TT_MAX_SIZE_MB));
+    size_t maxClusters = (sizeMB * 1024 * 1024) / sizeof(TTCluster);
+
+    // Round down to a power of two so the index is a simple mask
+    size_t powerOfTwo = 1;
+    while (powerOfTwo * 2 <= maxClusters) powerOfTwo *= 2;
+
+    clusters.reset();  // Free the old table before allocating the new one
+    clusters.reset(new TTCluster[powerOfTwo]);
+    clusterCount = powerOfTwo;
+    clusterMask = powerOfTwo - 1;
+    clear();
+}
+
+/**
+ * Wipes every entry and resets the generation counter, keeping the current allocation.
+ */
+void TranspositionTable::clear() {
+    for (size_t c = 0; c < clusterCount; ++c) {
+        for (int i = 0; i < TT_CLUSTER_SIZE; ++i) {
+            clusters[c].data[i].store(0, std::memory_order_relaxed);
+            clusters[c].keys[i].store(0, std::memory_order_relaxed);
+        }
+        clusters[c].padding = 0;
+    }
+    generation8 = 0;
+}
+
+/**
+ * Advances the table generation. Called once at the start of every search so entries
+ * written by earlier searches age and become preferred replacement victims.
+ */
+void TranspositionTable::newSearch() { generation8 += TT_GENERATION_DELTA; }
+
+/**
+ * Computes how many generations ago an entry was written.
+ *
+ * - The generation counter wraps around, so the difference is taken modulo the cycle.
+ *
+ * @param genBound8 The generation/bound byte of the entry.
+ * @return The age in units of TT_GENERATION_DELTA.
+ */
+int TranspositionTable::relativeAge(uint8_t genBound8) const {
+    return (TT_GENERATION_CYCLE + generation8 - genBound8) & TT_GENERATION_MASK;
+}
+
+/**
+ * Looks up a position in the table.
+ *
+ * - Only the cluster selected by the low bits of the hash is examined (one cache line).
+ * - A slot matches when its stored partial key, unfolded with its data word, equals
+ *   the upper 32 bits of the hash.
+ * - Safe to call while other threads store into the same cluster.
+ *
+ * @param hash The Zobrist hash of the board position.
+ * @param entry Output parameter receiving the decoded entry on a hit.
+ * @return True if the position was found, false otherwise.
+ */
+bool TranspositionTable::probe(uint64_t hash, TranspositionTableEntry& entry) const {
+    const TTCluster& cluster = clusters[clusterIndex(hash)];
+    uint32_t key32 = uint32_t(hash >> 32);
+
+    for (int i = 0; i < TT_CLUSTER_SIZE; ++i) {
+        uint64_t data = cluster.data[i].load(std::memory_order_relaxed);
+        uint32_t key = cluster.keys[i].load(std::memory_order_relaxed) ^ ttKeyCheck(data);
+        if (key == key32 && ttDepth8(data) != 0) {
+            entry.bestMove = ttMove(data);
+            entry.evaluation = ttEvaluation(data);
+            entry.depth = ttDepth8(data) - TT_DEPTH_OFFSET;
+            entry.eval_type = ttGenBound8(data) & (TT_GENERATION_DELTA - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Writes a position into the table using depth + age replacement.
+ *
+ * - If the position already has a slot, it is overwritten when the new result is exact,
+ *   at least as deep, or the old one comes from a previous search. A known best move is
+ *   kept when the new result does not provide one.
+ * - Otherwise an empty slot is used, or the slot with the lowest (depth - age) score is
+ *   evicted, so shallow results from old searches go first.
+ * - Lockless: concurrent writers may lose an update, but never corrupt a probe.
  *
- * @param table The transposition table to update.
  * @param hash The Zobrist hash of the board position.
  * @param bestMove The best move found for this position.
  * @param evaluation The evaluation score of the position.
  * @param depth The depth at which this evaluation was obtained.
  * @param eval_type The type of evaluation (exact, lower bound, upper bound).
  */
-void updateTranspositionTable(TranspositionTable& table, uint64_t hash, uint16_t bestMove,
-                              double evaluation, int depth, int eval_type) {
-    auto& entry = table[hash];  // Access or create the entry
-    // entry.visitCount++;
-    if (depth > entry.depth) {  // Only update if depth is greater
-        entry.bestMove = bestMove;
-        entry.evaluation = evaluation;
-        entry.depth = depth;
-        entry.eval_type = eval_type;
+void TranspositionTable::store(uint64_t hash, uint16_t bestMove, int evaluation, int depth,
+                               int eval_type) {
+    TTCluster& cluster = clusters[clusterIndex(hash)];
+    uint32_t key32 = uint32_t(hash >> 32);
+    int depth8 = std::max(1, std::min(255, depth + TT_DEPTH_OFFSET));
+
+    uint64_t slots[TT_CLUSTER_SIZE];
+    int replace = 0;
+    bool sameKey = false;
+    for (int i = 0; i < TT_CLUSTER_SIZE; ++i) {
+        slots[i] = cluster.data[i].load(std::memory_order_relaxed);
+        uint32_t key = cluster.keys[i].load(std::memory_order_relaxed) ^ ttKeyCheck(slots[i]);
+        if (ttDepth8(slots[i]) == 0 || key == key32) {
+            replace = i;
+            sameKey = ttDepth8(slots[i]) != 0;
+            break;
+        }
+        // Prefer to evict shallow entries from older searches
+        if (ttDepth8(slots[replace]) - relativeAge(ttGenBound8(slots[replace])) >
+            ttDepth8(slots[i]) - relativeAge(ttGenBound8(slots[i]))) {
+            replace = i;
+        }
+    }
+
+    uint64_t old = slots[replace];
+    if (sameKey) {
+        if (bestMove == 0) bestMove = ttMove(old);
+        if (eval_type != EXACT_SCORE && depth8 < ttDepth8(old) &&
+            relativeAge(ttGenBound8(old)) == 0) {
+            return;  // Keep the deeper result from this search
+        }
     }
+
+    uint64_t data = packTTData(bestMove, depth8, uint8_t(generation8 | eval_type), evaluation);
+    cluster.keys[replace].store(key32 ^ ttKeyCheck(data), std::memory_order_relaxed);
+    cluster.data[replace].store(data, std::memory_order_relaxed);
 }
 
 /**
- * Retrieves an entry from the transposition table.
+ * Estimates table occupancy in permille by sampling the first 1000 slots.
  *
- * - Searches for the given hash in the table.
- * - If found, copies the entry and returns true.
- * - If not found, returns false.
+ * - Only entries written by the current search are counted.
  *
- * @param table The transposition table.
- * @param hash The Zobrist hash of the board position.
- * @param entry Output parameter to store the found entry.
- * @return True if the entry was found, false otherwise.
+ * @return The number of used slots per thousand.
  */
-bool getTranspositionTableEntry(const TranspositionTable& table, uint64_t hash,
-                                TranspositionTableEntry& entry) {
-    auto it = table.find(hash);
-    if (it != table.end()) {
-        entry = it->second;
-        return true;
+int TranspositionTable::hashfull() const {
+    size_t sampleClusters = std::min<size_t>(clusterCount, 1000 / TT_CLUSTER_SIZE);
+    int used = 0;
+    for (size_t c = 0; c < sampleClusters; ++c) {
+        for (int i = 0; i < TT_CLUSTER_SIZE; ++i) {
+            uint64_t data = clusters[c].data[i].load(std::memory_order_relaxed);
+            if (ttDepth8(data) != 0 && (ttGenBound8(data) & TT_GENERATION_MASK) == generation8) {
+                used++;
+            }
+        }
     }
-    return false;
+    return used * 1000 / int(sampleClusters * TT_CLUSTER_SIZE);
+}
+
+/**
+ * @return The allocated size of the table in megabytes.
+ */
+size_t TranspositionTable::sizeMB() const {
+    return clusterCount * sizeof(TTCluster) / (1024 * 1024);
 }
 
 /**
- * Increments the visit count of a transposition table entry.
+ * Updates the transposition table with a new entry.
  *
- * - If the hash exists in the table, increments its visit count.
- * - This is used for three-fold repetition detection.
- * 
- * @param table The transposition table.
+ * - Replacement is decided by `TranspositionTable::store` (depth + age).
+ * - Stores the best move, evaluation, depth, and evaluation type.
+ *
+ * @param table The transposition table to update.
  * @param hash The Zobrist hash of the board position.
+ * @param bestMove The best move found for this position.
+ * @param evaluation The evaluation score of the position.
+ * @param depth The depth at which this evaluation was obtained.
+ * @param eval_type The type of evaluation (exact, lower bound, upper bound).
  */
-void incrementVisitCount(TranspositionTable& table, uint64_t hash) {
-    auto it = table.find(hash);
-    if (it != table.end()) {
-        it->second.visitCount++;
-    }
+void updateTranspositionTable(TranspositionTable& table, uint64_t hash, uint16_t bestMove,
+                              double evaluation, int depth, int eval_type) {
+    table.store(hash, bestMove, int(evaluation), depth, eval_type);
 }
 
 /**
- * Decrements the visit count of a transposition table entry.
+ * Retrieves an entry from the transposition table.
  *
- * - If the hash exists and the visit count is greater than 0, decrements it.
+ * - Searches for the given hash in the table.
+ * - If found, copies the entry and returns true.
+ * - If not found, returns false.
  *
  * @param table The transposition table.
  * @param hash The Zobrist hash of the board position.
+ * @param entry Output parameter to store the found entry.
+ * @return True if the entry was found, false otherwise.
  */
-void decrementVisitCount(TranspositionTable& table, uint64_t hash) {
-    auto it = table.find(hash);
-    if (it != table.end() && it->second.visitCount > 0) {
-        it->second.visitCount--;
-    }
-}
\ No newline at end of file
+bool getTranspositionTableEntry(const TranspositionTable& table, uint64_t hash,
+                                TranspositionTableEntry& entry) {
+    return table.probe(hash, entry);
+}
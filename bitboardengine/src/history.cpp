@@ -0,0 +1,46 @@
+#include "history.hpp"
+
+/**
+ * Forgets everything learned, for a new game.
+ */
+void HistoryTables::clear() {
+    for (auto& row : counterMoves) row.fill(0);
+    for (auto& side : butterfly) {
+        for (auto& row : side) row.fill(0);
+    }
+    for (auto& piece : continuation) {
+        for (PieceToHistory& table : piece) {
+            for (auto& row : table) row.fill(0);
+        }
+    }
+    for (auto& piece : captures) {
+        for (auto& row : piece) row.fill(0);
+    }
+}
+
+/**
+ * Halves every score before a new search.
+ *
+ * - What was learned on the previous move mostly still holds, but should give way
+ *   quickly to what the new search finds.
+ * - Counter moves are kept as they are.
+ */
+void HistoryTables::age() {
+    for (auto& side : butterfly) {
+        for (auto& row : side) {
+            for (int16_t& entry : row) entry /= 2;
+        }
+    }
+    for (auto& piece : continuation) {
+        for (PieceToHistory& table : piece) {
+            for (auto& row : table) {
+                for (int16_t& entry : row) entry /= 2;
+            }
+        }
+    }
+    for (auto& piece : captures) {
+        for (auto& row : piece) {
+            for (int16_t& entry : row) entry /= 2;
+        }
+    }
+}
@@ -1,12 +1,14 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <cstdlib>
 
 // #include "bitboard.hpp"
 // #include "movegen.hpp"
 // #include "move.hpp"
 // #include "evaluate.hpp"
-#include "search.hpp"
+#include "bench.hpp"
+#include "perft.hpp"
 using namespace std;
 
 // Function to print usage instructions
@@ -16,24 +18,83 @@ void printUsage() {
 }
 
 void printTranspositionTable(const TranspositionTable& table) {
-    std::cout << "Transposition Table Contents:" << std::endl;
-    std::cout << std::setw(20) << "Zobrist Hash"
-              << std::setw(15) << "Visit Count"
-              << std::setw(15) << "Best Move"
-              << std::setw(15) << "Evaluation"
-              << std::setw(10) << "Depth" << std::endl;
-    std::cout << std::string(75, '-') << std::endl;
-
-    for (const auto& [key, entry] : table) {
-        std::cout << std::setw(20) << key
-                  << std::setw(15) << entry.visitCount
-                  << std::setw(15) << moveToString(entry.bestMove)
-                  << std::setw(15) << entry.evaluation
-                  << std::setw(10) << entry.depth << std::endl;
+    std::cout << "Transposition Table:" << std::endl;
+    std::cout << std::setw(15) << "Size (MB)"
+              << std::setw(15) << "Hashfull" << std::endl;
+    std::cout << std::string(30, '-') << std::endl;
+    std::cout << std::setw(15) << table.sizeMB()
+              << std::setw(15) << table.hashfull() << std::endl;
+}
+
+void handleSetOption(const std::string& args, SearchContext& context) {
+    context.threads.waitForSearchFinished();  // Options are never changed under a running search
+    std::istringstream iss(args);
+    std::string token, name, value;
+
+    // setoption name <id> [value <x>]
+    iss >> token;
+    while (iss >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    std::getline(iss >> std::ws, value);
+
+    if (name == "Hash") {
+        int sizeMB = std::atoi(value.c_str());
+        if (sizeMB < 1 || sizeMB > TT_MAX_SIZE_MB) {
+            std::cerr << "Error: Hash must be between 1 and " << TT_MAX_SIZE_MB << " MB." << std::endl;
+            return;
+        }
+        context.table.resize(sizeMB);
+    } else if (name == "Threads") {
+        int threads = std::atoi(value.c_str());
+        if (threads < 1 || threads > MAX_THREADS) {
+            std::cerr << "Error: Threads must be between 1 and " << MAX_THREADS << "." << std::endl;
+            return;
+        }
+        context.threads.set(threads);
+    } else if (name == "MoveOverhead") {
+        int overhead = std::atoi(value.c_str());
+        if (overhead < 0 || overhead > MAX_MOVE_OVERHEAD_MS) {
+            std::cerr << "Error: MoveOverhead must be between 0 and " << MAX_MOVE_OVERHEAD_MS
+                      << " ms." << std::endl;
+            return;
+        }
+        context.moveOverheadMs = overhead;
+    } else if (name == "Ponder") {
+        // Nothing to configure: the GUI decides when to send `go ponder`
+    } else if (name == "ParallelMode") {
+        if (value == "LazySMP") {
+            context.parallelMode = LAZY_SMP;
+        } else if (value == "ABDADA") {
+            context.parallelMode = ABDADA;
+        } else {
+            std::cerr << "Error: ParallelMode must be LazySMP or ABDADA." << std::endl;
+        }
+    } else if (name == "NullMove" || name == "ReverseFutility" || name == "Razoring" ||
+               name == "Futility" || name == "LateMovePruning" || name == "LateMoveReductions" ||
+               name == "CheckExtension" || name == "SingularExtension" ||
+               name == "RecaptureExtension" || name == "QSearchChecks") {
+        if (value != "true" && value != "false") {
+            std::cerr << "Error: " << name << " must be true or false." << std::endl;
+            return;
+        }
+        bool enabled = value == "true";
+        if (name == "NullMove") context.pruning.nullMove = enabled;
+        else if (name == "ReverseFutility") context.pruning.reverseFutility = enabled;
+        else if (name == "Razoring") context.pruning.razoring = enabled;
+        else if (name == "Futility") context.pruning.futility = enabled;
+        else if (name == "LateMovePruning") context.pruning.lateMovePruning = enabled;
+        else if (name == "LateMoveReductions") context.pruning.lateMoveReductions = enabled;
+        else if (name == "CheckExtension") context.pruning.checkExtension = enabled;
+        else if (name == "SingularExtension") context.pruning.singularExtension = enabled;
+        else if (name == "RecaptureExtension") context.pruning.recaptureExtension = enabled;
+        else context.pruning.qsearchChecks = enabled;
+    } else {
+        std::cerr << "Error: Unknown option: " << name << std::endl;
     }
 }
 
-void handlePosition(const std::string& args, BoardState& board, TranspositionTable& table) {
+void handlePosition(const std::string& args, BoardState& board, SearchContext& context) {
     std::istringstream iss(args);
     std::string token;
 
@@ -45,14 +106,6 @@ void handlePosition(const std::string& args, BoardState& board, TranspositionTab
     if (token == "startpos") {
         BoardState startpos;
         board = startpos;
-        if (iss >> token && token == "moves") {
-            std::string move;
-            while (iss >> move) {
-                applyMove(board, encodeUCIMove(board, move));
-                updateTranspositionTable(table, board.getZobristHash());
-                incrementVisitCount(table, board.getZobristHash());
-            }
-        }
     } else if (token == "fen") {
         std::string fen, fenPart;
         for (int i = 0; i < 6; ++i) {  // FEN strings have 6 parts.
@@ -63,67 +116,88 @@ void handlePosition(const std::string& args, BoardState& board, TranspositionTab
             fen += (i > 0 ? " " : "") + fenPart;
         }
         board = parseFEN(fen);
-        if (iss >> token && token == "moves") {
-            std::string move;
-            while (iss >> move) {
-                applyMove(board, encodeUCIMove(board, move));
-                updateTranspositionTable(table, board.getZobristHash());
-                incrementVisitCount(table, board.getZobristHash());
-            }
-        }
     } else {
         std::cerr << "Error: Invalid argument for position command: " << token << std::endl;
+        return;
     }
 
+    // Remember every position played so the search can see repetitions with game history
+    context.gameHistory.clear();
+    if (iss >> token && token == "moves") {
+        std::string move;
+        while (iss >> move) {
+            context.gameHistory.push_back(board.getZobristHash());
+            applyMove(board, encodeUCIMove(board, move));
+        }
+    }
 }
 
-void handleGo(const std::string& args, BoardState& board, TranspositionTable& table) {
-    int wtime = -1, btime = -1, movestogo = 30, movetime = -1;
-    bool infinite = false;
+void handleGo(const std::string& args, BoardState& board, SearchContext& context) {
+    SearchLimits limits;
+    limits.depth = MAX_SEARCH_PLY;  // The other limits decide when to stop unless depth is given
 
     std::istringstream iss(args);
     std::string token;
+    bool readingSearchMoves = false;
+    MoveList legalMoves = allLegalMoves(board);
     while (iss >> token) {
+        if (readingSearchMoves) {
+            // searchmoves <move1> ... <movei> runs until the next keyword
+            auto move = std::find_if(legalMoves.begin(), legalMoves.end(),
+                                     [&](uint16_t m) { return moveToString(m) == token; });
+            if (move != legalMoves.end()) {
+                limits.searchMoves.push_back(*move);
+                continue;
+            }
+            readingSearchMoves = false;
+        }
+
         if (token == "wtime") {
-            iss >> wtime;
+            iss >> limits.wtime;
         } else if (token == "btime") {
-            iss >> btime;
+            iss >> limits.btime;
+        } else if (token == "winc") {
+            iss >> limits.winc;
+        } else if (token == "binc") {
+            iss >> limits.binc;
         } else if (token == "movestogo") {
-            iss >> movestogo;
+            iss >> limits.movestogo;
         } else if (token == "movetime") {
-            iss >> movetime;
+            iss >> limits.movetime;
+        } else if (token == "depth") {
+            iss >> limits.depth;
+            limits.depth = std::max(1, std::min(limits.depth, MAX_SEARCH_PLY));
+        } else if (token == "nodes") {
+            iss >> limits.nodes;
+        } else if (token == "mate") {
+            iss >> limits.mate;
         } else if (token == "infinite") {
-            infinite = true;
-        }
-    }
-
-    // Determine available time for this move
-    int timeLimitMs = -1;
-    if (movetime != -1) {
-        timeLimitMs = movetime;
-    } else if (board.getTurn()) {  // White to move
-        if (wtime > 0) {
-            timeLimitMs = (wtime / movestogo);
-        }
-    } else {  // Black to move
-        if (btime > 0) {
-            timeLimitMs = (btime / movestogo);
+            limits.infinite = true;
+        } else if (token == "ponder") {
+            limits.ponder = true;  // The time limit only starts counting on ponderhit
+        } else if (token == "searchmoves") {
+            readingSearchMoves = true;
         }
     }
 
-    if (timeLimitMs == -1 && !infinite) {
+    int timeLeft = board.getTurn() ? limits.wtime : limits.btime;
+    bool hasLimit = limits.movetime >= 0 || timeLeft >= 0 || limits.depth < MAX_SEARCH_PLY ||
+                    limits.nodes > 0 || limits.mate > 0;
+    if (!hasLimit && !limits.infinite) {
         std::cerr << "Invalid time configuration in 'go' command" << std::endl;
         return;
     }
 
-    // Call iterative deepening with the calculated time limit
-    // std::vector<uint16_t> legalMoves = generateLegalMoves(board);
-    Search search(board, table, timeLimitMs);
-    uint16_t bestMove = search.iterativeDeepening();
-    // uint16_t bestMove = iterativeDeepening(board, table, timeLimitMs);
+    if (limits.infinite) {
+        limits.wtime = limits.btime = limits.movetime = -1;
+    }
 
-    // Print the best move in UCI format
-    std::cout << "bestmove " << moveToString(bestMove) << std::endl;
+    // Run iterative deepening on every search thread; thread 0 turns the clock into a
+    // budget for this move. The search runs in the background and prints `bestmove`
+    // itself when it is done, so the input loop stays free to handle `stop`, `isready`
+    // and `quit`.
+    context.threads.startThinking(board, context, limits, true);
+    // uint16_t bestMove = iterativeDeepening(board, table, timeLimitMs);
 }
 
 int main(int argc, char* argv[]) {
@@ -131,11 +205,22 @@ int main(int argc, char* argv[]) {
     initKnightThreatMasks();
     initPawnThreatMasks();
     initmagicmoves();
+    initBetweenMasks();
     initializeZobrist();
+    initReductions();
+
+    // `chess_engine bench [depth] [threads] [hashMB]` runs the benchmark and exits
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        int depth = argc > 2 ? std::atoi(argv[2]) : BENCH_DEFAULT_DEPTH;
+        int threads = argc > 3 ? std::atoi(argv[3]) : 1;
+        int hashMB = argc > 4 ? std::atoi(argv[4]) : TT_DEFAULT_SIZE_MB;
+        runBench(depth, threads, hashMB);
+        return 0;
+    }
 
     // Create a BoardState object
     BoardState board;  // Initialize board state
-    TranspositionTable table;
+    SearchContext context;  // Lives for the whole session, cleared on ucinewgame
 
     /* Import UCI moves from command line rather than from cin
     // Example UCI moves
@@ -156,9 +241,8 @@ int main(int argc, char* argv[]) {
             uint16_t encodedMove = encodeUCIMove(board, uciMove);
             // std::cout << "UCI Move: " << uciMove << " -> Encoded Move: " << moveToString(encodedMove)
             //           << std::endl;
+            context.gameHistory.push_back(board.getZobristHash());
             applyMove(board, encodedMove);  // Apply the move to the board
-            updateTranspositionTable(table, board.getZobristHash());
-            incrementVisitCount(table, board.getZobristHash());
             // cout << "adding " << board.getZobristHash() << " to table after " << moveToString(encodedMove) << "\n";
         } catch (const std::exception& e) {
             std::cerr << "Error: " << e.what() << std::endl;
@@ -207,30 +291,125 @@ int main(int argc, char* argv[]) {
         iss >> command;
 
         if (command == "uci") {
-            std::cout << "id name ColbysBot\n";
-            std::cout << "id author Colby Smith\n";
-            std::cout << "uciok" << std::endl;
+            std::ostringstream options;
+            options << "id name ColbysBot\n";
+            options << "id author Colby Smith\n";
+            options << "option name Hash type spin default " << TT_DEFAULT_SIZE_MB
+                    << " min 1 max " << TT_MAX_SIZE_MB << "\n";
+            options << "option name Threads type spin default 1 min 1 max " << MAX_THREADS << "\n";
+            options << "option name MoveOverhead type spin default " << DEFAULT_MOVE_OVERHEAD_MS
+                    << " min 0 max " << MAX_MOVE_OVERHEAD_MS << "\n";
+            options << "option name Ponder type check default false\n";
+            options << "option name ParallelMode type combo default LazySMP var LazySMP var ABDADA\n";
+            options << "option name NullMove type check default true\n";
+            options << "option name ReverseFutility type check default true\n";
+            options << "option name Razoring type check default true\n";
+            options << "option name Futility type check default true\n";
+            options << "option name LateMovePruning type check default true\n";
+            options << "option name LateMoveReductions type check default true\n";
+            options << "option name CheckExtension type check default true\n";
+            options << "option name SingularExtension type check default true\n";
+            options << "option name RecaptureExtension type check default true\n";
+            options << "option name QSearchChecks type check default false\n";
+            options << "uciok";
+            uciOutput.write(options.str(), true);
         } else if (command == "isready") {
-            std::cout << "readyok" << std::endl;
+            uciOutput.write("readyok", true);  // Answered at once, even during a search
         } else if (command == "ucinewgame") {
             BoardState newBoard;
             board = newBoard;
+            context.clear();
+        } else if (command == "setoption") {
+            std::string args;
+            std::getline(iss, args);
+            handleSetOption(args, context);
         } else if (command == "position") {
             std::string args;
             std::getline(iss, args);
-            handlePosition(args, board, table);
+            handlePosition(args, board, context);
         } else if (command == "go") {
             std::string args;
             std::getline(iss, args);
-            handleGo(args, board, table);
+            handleGo(args, board, context);
+        } else if (command == "bench") {
+            // bench [depth] [threads] [hashMB], with the pruning options set by setoption
+            context.threads.waitForSearchFinished();
+            int depth = BENCH_DEFAULT_DEPTH, threads = 1, hashMB = TT_DEFAULT_SIZE_MB;
+            iss >> depth >> threads >> hashMB;
+            runBench(depth, threads, hashMB, context.pruning);
+        } else if (command == "perft" || command == "divide") {
+            // perft|divide <depth> [threads] [hashMB]
+            context.threads.waitForSearchFinished();
+            int depth = 1, threads = 1, hashMB = PERFT_DEFAULT_HASH_MB;
+            iss >> depth >> threads >> hashMB;
+            runPerft(depth, std::max(1, threads), hashMB, command == "divide", board);
+        } else if (command == "perftsuite") {
+            // perftsuite [threads] [hashMB]
+            context.threads.waitForSearchFinished();
+            int threads = 1, hashMB = PERFT_DEFAULT_HASH_MB;
+            iss >> threads >> hashMB;
+            runPerftSuite(std::max(1, threads), hashMB);
+        } else if (command == "ttbench") {
+            // ttbench [movetimeMs] [plies]
+            context.threads.waitForSearchFinished();
+            int movetimeMs = 1000, plies = 8;
+            iss >> movetimeMs >> plies;
+            ttReuseBench(movetimeMs, plies);
+        } else if (command == "smpbench") {
+            // smpbench [depth] [maxThreads]
+            context.threads.waitForSearchFinished();
+            int depth = 5, maxThreads = 4;
+            iss >> depth >> maxThreads;
+            smpScalingBench(depth, maxThreads);
+        } else if (command == "ponderbench") {
+            // ponderbench [movetimeMs] [plies]
+            context.threads.waitForSearchFinished();
+            int movetimeMs = 100, plies = 40;
+            iss >> movetimeMs >> plies;
+            ponderBench(movetimeMs, plies);
+        } else if (command == "allocbench") {
+            // allocbench [depth]
+            context.threads.waitForSearchFinished();
+            int depth = BENCH_DEFAULT_DEPTH;
+            iss >> depth;
+            allocBench(depth);
+        } else if (command == "makebench") {
+            // makebench [rounds]
+            context.threads.waitForSearchFinished();
+            int rounds = 20000;
+            iss >> rounds;
+            makeUnmakeBench(rounds);
+        } else if (command == "qsearchbench") {
+            // qsearchbench [rounds]
+            context.threads.waitForSearchFinished();
+            int rounds = 20;
+            iss >> rounds;
+            qsearchBench(rounds);
+        } else if (command == "orderbench") {
+            // orderbench [rounds]
+            context.threads.waitForSearchFinished();
+            int rounds = 200;
+            iss >> rounds;
+            moveOrderBench(rounds);
+        } else if (command == "epd") {
+            // epd [depth] [movetimeMs] [file], with the pruning options set by setoption
+            context.threads.waitForSearchFinished();
+            int depth = 8, movetimeMs = 0;
+            std::string file;
+            iss >> depth >> movetimeMs >> file;
+            epdBench(depth, movetimeMs, file, context.pruning);
+        } else if (command == "ponderhit") {
+            context.threads.ponder = false;  // Keep searching, now on our own clock
         } else if (command == "stop") {
-            std::cout << "Stopping search." << std::endl;
-            // Logic to stop search would go here.
+            context.threads.stop = true;  // The search thread prints bestmove
+            context.threads.waitForSearchFinished();
         } else if (command == "quit") {
-            std::cout << "Quitting engine." << std::endl;
+            context.threads.stop = true;
+            context.threads.waitForSearchFinished();
+            uciOutput.write("Quitting engine.", true);
             break;
         } else {
-            std::cout << "Unknown command: " << command << std::endl;
+            uciOutput.write("Unknown command: " + command, true);
         }
     }
 
@@ -257,7 +436,7 @@ int main(int argc, char* argv[]) {
     // auto end = std::chrono::high_resolution_clock::now();
     // std::chrono::duration<double> elapsed = end - start;
     // std::cout << "Time taken: " << elapsed.count() << " seconds" << std::endl;
-    // std::cout << "Transpositon table entries: " << table.size() << endl;
+    // std::cout << "Transpositon table hashfull: " << table.hashfull() << endl;
     // cout << moveToString(bestMove);
     // return 0;
 }
\ No newline at end of file
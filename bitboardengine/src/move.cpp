@@ -1,4 +1,5 @@
 #include "move.hpp"
+#include "movegen.hpp"
 
 /**
  * Converts a uint16_t move into its string representation.
@@ -42,155 +43,70 @@ std::string moveToString(uint16_t move) {
     return moveString.str();
 }
 
-/**
- * Stores the necessary board state data before making a move.
- *
- * - Captures castling rights, en passant square, move counters, and captured piece.
- * - Used for move undo functionality.
- *
- * @param board The current board state.
- * @param move The move being applied.
- * @return A MoveUndo object storing relevant pre-move state data.
- */
-MoveUndo storeUndoData(const BoardState& board, uint16_t move) {
-    MoveUndo undoState;
-    // Decode the move
-    int fromSquare, toSquare, special;
-    decodeMove(move, fromSquare, toSquare, special);
-
-    // Retrieve relevant bitboards
-    uint64_t sourceMask = (1ULL << fromSquare);
-    uint64_t destMask = (1ULL << toSquare);
-    bool isWhite = board.getTurn();
-
-    // Find the source piece type
-    undoState.from_piece_type = findPieceType(board, sourceMask, isWhite);
-
-    // Save the source piece's bitboard
-    undoState.fromBitboard = board.getBitboard(undoState.from_piece_type);
-
-    // Save captured piece details if a capture is happening
-    uint64_t enemyOccupancy = board.getOccupancy(!isWhite);
-    undoState.capture = enemyOccupancy & destMask;
-
-    // En passant
-    if (special == EN_PASSANT) {
-        int enemy_pawn_index = isWhite ? BLACK_PAWNS : WHITE_PAWNS;
-        uint64_t enemy_pawn_bitboard = board.getBitboard(enemy_pawn_index);
-
-        undoState.captured_piece_type = enemy_pawn_index;
-        undoState.capturedBitboard = enemy_pawn_bitboard;
-        undoState.capture = true;
-
-    } else if (undoState.capture) {
-        // Find the captured piece type
-        undoState.captured_piece_type = findPieceType(board, destMask, !isWhite);
-
-        // Save the captured piece's bitboard
-        undoState.capturedBitboard = board.getBitboard(undoState.captured_piece_type);
-    } else {
-        undoState.captured_piece_type = -1;
-        undoState.capturedBitboard = 0;
-    }
-
-    // Save promoted-piece information
-    if (special >= PROMOTION_QUEEN && special <= PROMOTION_BISHOP) {
-        undoState.promotedPieceType = getPromotedPieceType(special, isWhite);
-        undoState.promotedBitboard = board.getBitboard(undoState.promotedPieceType);
-    }
-
-    // Store additional state
-    undoState.enPassantState = board.getEnPassant();
-    undoState.castlingRights = board.getCastlingRights();
-    undoState.halfMoveClock = board.getHalfmoveClock();
-    undoState.moveCounter = board.getFullmoveNumber();
-    undoState.move = move;
-    return undoState;
-}
+/*
+Castling rights kept by a move touching each square: moving from or to a king or rook
+home square gives up the rights tied to it (bit 0 white kingside, bit 1 white queenside,
+bit 2 black kingside, bit 3 black queenside).
+*/
+static constexpr uint8_t CASTLING_RIGHTS_MASK[64] = {
+    13, 15, 15, 15, 12, 15, 15, 14,  // a1 drops white queenside, e1 both, h1 kingside
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+     7, 15, 15, 15,  3, 15, 15, 11,  // a8 drops black queenside, e8 both, h8 kingside
+};
 
 /**
  * Applies a move to the board and updates necessary game state data.
  *
- * - Decodes and executes the move.
- * - Updates piece bitboards, occupancy bitboards, and Zobrist hash.
+ * - Decodes and executes the move with the board's piece-level primitives.
+ * - Updates the Zobrist hash incrementally.
  * - Handles special moves: captures, promotions, castling, and en passant.
- * - Updates move counters and flips the turn.
+ * - Updates castling rights through CASTLING_RIGHTS_MASK, move counters, and flips the turn.
+ * - Pushes a StateInfo with the check and pin information of the new position.
  *
  * @param board The board state to modify.
  * @param move The move to apply.
  * @return A MoveUndo object containing data to revert the move if needed.
  */
 MoveUndo applyMove(BoardState& board, uint16_t move) {
-    MoveUndo moveData = storeUndoData(board, move);
-    uint64_t zobristHash = board.getZobristHash();
     // Decode the move
     int fromSquare, toSquare, special;
     decodeMove(move, fromSquare, toSquare, special);
-
-    uint64_t sourceMask = (1ULL << fromSquare);
-    uint64_t destMask = (1ULL << toSquare);
     bool isWhite = board.getTurn();
-    bool capture = false;
-    bool pawn_move = false;
-    bool revoked_castling_rights = false;
-
-    // Identify the moving piece and its bitboard
-    int pieceType = findPieceType(board, sourceMask, isWhite);
-
-    uint64_t fromPieceBitboard = findBitboard(board, fromSquare, isWhite);
-    int enemyRooks = isWhite ? BLACK_ROOKS : WHITE_ROOKS;
-    int enemyKingSideCorner = isWhite ? 63 : 7;
-    int enemyQueenSideCorner = isWhite ? 56 : 0;
-    //If we're capturing a rook in the corner
-    if(destMask & board.getBitboard(enemyRooks)){
-        if(toSquare == enemyKingSideCorner){
-            board.revokeKingsideCastlingRights(!isWhite);
-        }
-        else if (toSquare == enemyQueenSideCorner){
-            board.revokeQueensideCastlingRights(!isWhite);
-        }
-    }
+    int pieceType = board.pieceOn(fromSquare);
+    uint64_t zobristHash = board.getZobristHash();
 
-    // Remove the piece from the old square and add it to the new one
-    // If promoting, remove the pawn and add the promoted piece.
-    if (special >= PROMOTION_QUEEN && special <= PROMOTION_BISHOP) { 
-        int promotionType = getPromotedPieceType(special, isWhite);
-        uint64_t promotionBitboard = board.getBitboard(promotionType) | destMask;
-        zobristHash ^= zobristTable[promotionType][toSquare];
-        board.updateBitboard(promotionType, promotionBitboard);
+    MoveUndo undoState;
+    undoState.zobristHash = zobristHash;
+    undoState.move = move;
+    undoState.halfMoveClock = board.getHalfmoveClock();
+    undoState.capturedPiece = NO_PIECE;
+    undoState.castlingRights = board.getCastlingRights();
+    undoState.enPassantState = board.getEnPassant();
 
-        // Remove the pawn from the board
-        zobristHash ^= zobristTable[pieceType][fromSquare];
-        fromPieceBitboard ^= sourceMask;  // remove the pawn
-        board.updateBitboard(pieceType, fromPieceBitboard);
+    // Handle captures
+    int captureSquare = special == EN_PASSANT ? toSquare + (isWhite ? -8 : 8) : toSquare;
+    int capturedType = board.pieceOn(captureSquare);
+    if (capturedType != NO_PIECE) {
+        zobristHash ^= zobristTable[capturedType][captureSquare];
+        board.removePiece(captureSquare);
+        undoState.capturedPiece = capturedType;
     }
-    else {
-        // Move the piece
-        fromPieceBitboard ^= sourceMask;  // Remove from source
-        fromPieceBitboard |= destMask;    // Add to destination
 
-        zobristHash ^= zobristTable[pieceType][fromSquare];
+    // Move the piece. If promoting, remove the pawn and add the promoted piece.
+    zobristHash ^= zobristTable[pieceType][fromSquare];
+    if (special >= PROMOTION_QUEEN && special <= PROMOTION_BISHOP) {
+        int promotionType = getPromotedPieceType(special, isWhite);
+        zobristHash ^= zobristTable[promotionType][toSquare];
+        board.removePiece(fromSquare);
+        board.putPiece(promotionType, toSquare);
+    } else {
         zobristHash ^= zobristTable[pieceType][toSquare];
-
-        board.updateBitboard(pieceType, fromPieceBitboard);
-    }
-    // Handle captures
-    if (special == EN_PASSANT) {
-        int captureSquare = toSquare + (isWhite ? -8 : 8);
-        uint64_t enemyPawnMask = (1ULL << captureSquare);
-        int enemyPawnType = isWhite ? BLACK_PAWNS : WHITE_PAWNS;
-        uint64_t enemyPawnBitboard = board.getBitboard(enemyPawnType) ^ enemyPawnMask;
-
-        zobristHash ^= zobristTable[enemyPawnType][toSquare];
-        board.updateBitboard(enemyPawnType, enemyPawnBitboard);
-        capture = true;
-    } else if (board.getOccupancy(!isWhite) & destMask) {
-        int capturedType = findPieceType(board, destMask, !isWhite);
-        uint64_t capturedBitboard = board.getBitboard(capturedType);
-        capturedBitboard ^= destMask;  // remove the bit
-        zobristHash ^= zobristTable[capturedType][toSquare];
-        board.updateBitboard(capturedType, capturedBitboard);
-        capture = true;
+        board.movePiece(fromSquare, toSquare);
     }
 
     // Handle castling
@@ -203,50 +119,32 @@ MoveUndo applyMove(BoardState& board, uint16_t move) {
             rookFromSquare = isWhite ? 0 : 56;
             rookToSquare = toSquare + 1;
         }
-        uint64_t rookFromMask = (1ULL << rookFromSquare);
-        uint64_t rookToMask = (1ULL << rookToSquare);
-        uint64_t rookBitboard = board.getBitboard(isWhite ? WHITE_ROOKS : BLACK_ROOKS);
-
-        zobristHash ^= zobristTable[isWhite ? WHITE_ROOKS : BLACK_ROOKS][rookFromSquare];
-        zobristHash ^= zobristTable[isWhite ? WHITE_ROOKS : BLACK_ROOKS][rookToSquare];
-
-        rookBitboard ^= rookFromMask;  // Remove rook from its initial position
-        rookBitboard |= rookToMask;    // Place rook in its new position
-        board.updateBitboard(isWhite ? WHITE_ROOKS : BLACK_ROOKS, rookBitboard);
+        int rookType = isWhite ? WHITE_ROOKS : BLACK_ROOKS;
+        zobristHash ^= zobristTable[rookType][rookFromSquare];
+        zobristHash ^= zobristTable[rookType][rookToSquare];
+        board.movePiece(rookFromSquare, rookToSquare);
     }
 
-    uint64_t oldCastlingRights = board.getCastlingRights();
-    zobristHash ^= zobristCastling[oldCastlingRights];
-
     // Handle castling rights
-    if (pieceType == WHITE_KINGS || pieceType == BLACK_KINGS) {
-        // King moves, clear both castling rights for this side
-        board.revokeAllCastlingRights(isWhite);
+    uint8_t oldCastlingRights = undoState.castlingRights;
+    uint8_t newCastlingRights =
+        oldCastlingRights & CASTLING_RIGHTS_MASK[fromSquare] & CASTLING_RIGHTS_MASK[toSquare];
+    if (newCastlingRights != oldCastlingRights) {
+        zobristHash ^= zobristCastling[oldCastlingRights];
+        zobristHash ^= zobristCastling[newCastlingRights];
+        board.setCastlingRights(newCastlingRights);
     }
 
-    if (pieceType == WHITE_ROOKS || pieceType == BLACK_ROOKS) {
-        // Rook moves, clear corresponding castling right
-        if (fromSquare == (isWhite ? 0 : 56)) {  // Queenside rook
-            board.revokeQueensideCastlingRights(isWhite);
-        } else if (fromSquare == (isWhite ? 7 : 63)) {  // Kingside rook
-            board.revokeKingsideCastlingRights(isWhite);
-        }
-    }
-
-    uint64_t newCastlingRights = board.getCastlingRights();
-    zobristHash ^= zobristCastling[newCastlingRights];
-
-    int oldEnPassantSquare = board.getEnPassant();
+    int oldEnPassantSquare = undoState.enPassantState;
     if (oldEnPassantSquare != NO_EN_PASSANT) {
-        int oldEnPassantFile = oldEnPassantSquare % 8;
-        zobristHash ^= zobristEnPassant[oldEnPassantFile];
+        zobristHash ^= zobristEnPassant[oldEnPassantSquare % 8];
     }
 
-    // Update en passant state
+    // Update en passant state: only set when an enemy pawn can actually capture
+    int newEnPassantSquare = NO_EN_PASSANT;
     if (special == DOUBLE_PAWN_PUSH) {
-        int enemy_pawn_index = isWhite ? BLACK_PAWNS : WHITE_PAWNS;
-        uint64_t enemyPawnBitboard = board.getBitboard(enemy_pawn_index);
         int epSquare = isWhite ? toSquare - 8 : toSquare + 8;
+        uint64_t enemyPawnBitboard = board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS);
         uint64_t adjacentMask = 0;
 
         // Not on the left edge
@@ -254,129 +152,124 @@ MoveUndo applyMove(BoardState& board, uint16_t move) {
 
         // Not on the right edge
         if (epSquare % 8 != 7) adjacentMask |= (1ULL << (toSquare + 1));
-        // If there's at least one enemy pawn adjacent, set the en passant square
         if (adjacentMask & enemyPawnBitboard) {
-            board.setEnPassant(epSquare);
-        } else {
-            board.setEnPassant(NO_EN_PASSANT);
+            newEnPassantSquare = epSquare;
+            zobristHash ^= zobristEnPassant[epSquare % 8];
         }
-    } else {
-        // Clear en passant state for all other moves
-        board.setEnPassant(NO_EN_PASSANT);
-    }
-    
-    int newEnPassantSquare = board.getEnPassant();
-    if (newEnPassantSquare != NO_EN_PASSANT) {
-        int newEnPassantFile = newEnPassantSquare % 8;
-        zobristHash ^= zobristEnPassant[newEnPassantFile];
     }
+    board.setEnPassant(newEnPassantSquare);
 
-    if (pieceType == WHITE_PAWNS || pieceType == BLACK_PAWNS) pawn_move = true;
     // Update counters
-    int halfmove = board.getHalfmoveClock();
-    halfmove = capture || pawn_move || revoked_castling_rights ? 0 : halfmove + 1;
-    int fullmove = board.getFullmoveNumber();
-    if (!isWhite) fullmove += 1;
+    bool pawnMove = pieceType == WHITE_PAWNS || pieceType == BLACK_PAWNS;
+    int halfmove = capturedType != NO_PIECE || pawnMove ? 0 : board.getHalfmoveClock() + 1;
+    board.setMoveCounters(halfmove, board.getFullmoveNumber() + (isWhite ? 0 : 1));
 
-    board.setMoveCounters(halfmove, fullmove);
     zobristHash ^= zobristSideToMove;
-
     board.flipTurn();
     board.setZobristHash(zobristHash);
+    board.pushState();
+    updateStateInfo(board);
 
-    return moveData;
+    return undoState;
 }
 
 /**
  * Restores the board to its previous state by undoing a move.
  *
- * - Restores captured pieces, castling rights, en passant state, and move counters.
- * - Reverts piece positions and bitboards.
- * - Updates Zobrist hash accordingly.
+ * - Moves the pieces back and restores any captured piece from the undo record.
+ * - Restores castling rights, en passant state, move counters, the Zobrist hash and
+ *   the previous StateInfo as they were, rather than recomputing them.
  * - Flips the turn back to the previous player.
  *
  * @param board The board state to modify.
  * @param undoState The stored state used to revert the move.
  */
 void undoMove(BoardState& board, const MoveUndo& undoState) {
-    // Retrieve the current Zobrist hash
-    uint64_t zobristHash = board.getZobristHash();
-
     // Flip the turn back
     board.flipTurn();
-    zobristHash ^= zobristSideToMove;  // Reverse turn flip in Zobrist hash
+    board.popState();
+    bool isWhite = board.getTurn();
 
-    // Restore moved piece to its original square
     int fromSquare, toSquare, special;
     decodeMove(undoState.move, fromSquare, toSquare, special);
 
-    // Restore captured piece if there was a capture
-    if (undoState.capture) {
-        zobristHash ^= zobristTable[undoState.captured_piece_type][toSquare];  // Add captured piece back
-        board.updateBitboard(undoState.captured_piece_type, undoState.capturedBitboard);
+    // Move the rook back to its original square
+    if (special == CASTLING_KINGSIDE) {
+        board.movePiece(toSquare - 1, isWhite ? 7 : 63);
+    } else if (special == CASTLING_QUEENSIDE) {
+        board.movePiece(toSquare + 1, isWhite ? 0 : 56);
     }
 
-    // Handle special logic for castling
-    if (special == CASTLING_KINGSIDE || special == CASTLING_QUEENSIDE) {
-        int rookFrom, rookTo;
-        if (special == CASTLING_KINGSIDE) {
-            rookFrom = (board.getTurn() ? 7 : 63);
-            rookTo = (board.getTurn() ? 5 : 61);
-        } else {
-            rookFrom = (board.getTurn() ? 0 : 56);
-            rookTo = (board.getTurn() ? 3 : 59);
-        }
-
-        // Move the rook back to its original square
-        int alliedRookIndex = board.getTurn() ? WHITE_ROOKS : BLACK_ROOKS;
-        uint64_t rookBitboard = board.getBitboard(alliedRookIndex);
-        rookBitboard ^= (1ULL << rookTo);    // Remove rook from castled-to square
-        rookBitboard |= (1ULL << rookFrom);  // Place rook back at original square
-        board.updateBitboard(alliedRookIndex, rookBitboard);
-
-        // Update Zobrist hash for the rook's movement
-        zobristHash ^= zobristTable[alliedRookIndex][rookTo];  // Remove rook from castled-to square
-        zobristHash ^= zobristTable[alliedRookIndex][rookFrom];  // Add rook back to original square
-    }
-
-    // Undo promotions
-    // Add back to source   
-    zobristHash ^= zobristTable[undoState.from_piece_type][fromSquare];
+    // Undo promotions, or move the piece back to its source
     if (special >= PROMOTION_QUEEN && special <= PROMOTION_BISHOP) {
-        // Remove promoted piece
-        zobristHash ^= zobristTable[undoState.promotedPieceType][toSquare];
-        board.updateBitboard(undoState.promotedPieceType, undoState.promotedBitboard);
-        int pawnType = board.getTurn() ? WHITE_PAWNS : BLACK_PAWNS;
-        uint64_t pawnBitboard = board.getBitboard(pawnType);
-        pawnBitboard |= (1ULL << fromSquare);
-        board.updateBitboard(pawnType, pawnBitboard);
+        board.removePiece(toSquare);
+        board.putPiece(isWhite ? WHITE_PAWNS : BLACK_PAWNS, fromSquare);
+    } else {
+        board.movePiece(toSquare, fromSquare);
     }
-    else{
-        zobristHash ^= zobristTable[undoState.from_piece_type][toSquare];    // Remove from destination
-        board.updateBitboard(undoState.from_piece_type, undoState.fromBitboard);
+
+    // Restore captured piece if there was a capture
+    if (undoState.capturedPiece != NO_PIECE) {
+        int captureSquare = special == EN_PASSANT ? toSquare + (isWhite ? -8 : 8) : toSquare;
+        board.putPiece(undoState.capturedPiece, captureSquare);
     }
+
     // Restore metadata
-    if (undoState.enPassantState != NO_EN_PASSANT) {
-        int enPassantFile = undoState.enPassantState % 8;
-        zobristHash ^= zobristEnPassant[enPassantFile];  // Add en passant square back
-    }
-    int currentEnPassant = board.getEnPassant();
-    if (currentEnPassant != NO_EN_PASSANT) {
-        int enPassantFile = currentEnPassant % 8;
-        zobristHash ^= zobristEnPassant[enPassantFile];  // Remove current en passant square
-    }
     board.setEnPassant(undoState.enPassantState);
-
-    // Restore castling rights
-    zobristHash ^= zobristCastling[board.getCastlingRights()];  // Remove current castling rights
-    zobristHash ^= zobristCastling[undoState.castlingRights];   // Add back old castling rights
     board.setCastlingRights(undoState.castlingRights);
+    board.setMoveCounters(undoState.halfMoveClock, board.getFullmoveNumber() - (isWhite ? 0 : 1));
+    board.setZobristHash(undoState.zobristHash);
+}
+
+/**
+ * Passes the turn without moving a piece, for null move pruning.
+ *
+ * - Clears the en passant square and resets the halfmove clock, so repetition detection
+ *   never looks back across a null move.
+ * - Pushes a StateInfo for the other side, like a normal move.
+ * - Must not be used while in check.
+ *
+ * @param board The board state to modify.
+ * @return A MoveUndo object (with move 0) to revert the null move.
+ */
+MoveUndo applyNullMove(BoardState& board) {
+    uint64_t zobristHash = board.getZobristHash();
 
-    // Restore move counters
-    board.setMoveCounters(undoState.halfMoveClock, undoState.moveCounter);
+    MoveUndo undoState;
+    undoState.zobristHash = zobristHash;
+    undoState.move = 0;
+    undoState.halfMoveClock = board.getHalfmoveClock();
+    undoState.capturedPiece = NO_PIECE;
+    undoState.castlingRights = board.getCastlingRights();
+    undoState.enPassantState = board.getEnPassant();
 
-    // Update the Zobrist hash
+    if (undoState.enPassantState != NO_EN_PASSANT) {
+        zobristHash ^= zobristEnPassant[undoState.enPassantState % 8];
+        board.setEnPassant(NO_EN_PASSANT);
+    }
+    board.setMoveCounters(0, board.getFullmoveNumber());
+
+    zobristHash ^= zobristSideToMove;
+    board.flipTurn();
     board.setZobristHash(zobristHash);
+    board.pushState();
+    updateStateInfo(board);
+
+    return undoState;
+}
+
+/**
+ * Takes back a null move played with `applyNullMove`.
+ *
+ * @param board The board state to modify.
+ * @param undoState The undo data returned by `applyNullMove`.
+ */
+void undoNullMove(BoardState& board, const MoveUndo& undoState) {
+    board.flipTurn();
+    board.popState();
+    board.setEnPassant(undoState.enPassantState);
+    board.setMoveCounters(undoState.halfMoveClock, board.getFullmoveNumber());
+    board.setZobristHash(undoState.zobristHash);
 }
 
 /**
@@ -563,8 +456,8 @@ bool isEnPassantMove(const BoardState& board, int fromSquare, int toSquare) {
 /**
  * Identifies the type of piece occupying a given square.
  *
- * - Checks the bitboards of all piece types for the current player.
- * - Returns the corresponding piece index if found.
+ * - Reads the board's mailbox, so the lookup is a single array access.
+ * - Returns the corresponding piece index if it belongs to the given side.
  * - If no matching piece is found, the function terminates the program.
  *
  * @param board The current board state.
@@ -573,15 +466,10 @@ bool isEnPassantMove(const BoardState& board, int fromSquare, int toSquare) {
  * @return The index of the piece occupying the square.
  */
 int findPieceType(const BoardState& board, uint64_t squareMask, bool isWhite) {
-    // Piece indices for the board's bitboards
-    const int pieceOffset = isWhite ? 0 : 6;  // White: 0-5, Black: 6-11
-
-    // Loop through the bitboards for all piece types
-    for (int i = 0; i < 6; ++i) {
-        int pieceIndex = pieceOffset + i;
-        if (board.getBitboard(pieceIndex) & squareMask) {
-            return pieceIndex;  // Return the index of the matching piece
-        }
+    int pieceIndex = squareMask ? board.pieceOn(__builtin_ctzll(squareMask)) : NO_PIECE;
+    // White: 0-5, Black: 6-11
+    if (pieceIndex != NO_PIECE && (pieceIndex < BLACK_PAWNS) == isWhite) {
+        return pieceIndex;
     }
     std::cout << "crashing inside of findPieceType on this board:\n";
     std::cout << board << std::endl;
@@ -596,8 +484,7 @@ int findPieceType(const BoardState& board, uint64_t squareMask, bool isWhite) {
 /**
  * Finds the bitboard corresponding to the piece on a given square.
  *
- * - Iterates through the bitboards of all pieces for the specified color.
- * - Identifies the bitboard that contains the given square.
+ * - Looks the piece up in the board's mailbox and returns its bitboard.
  * - Throws an exception if no piece is found on the square.
  *
  * @param board The current board state.
@@ -607,16 +494,9 @@ int findPieceType(const BoardState& board, uint64_t squareMask, bool isWhite) {
  * @throws std::runtime_error If no piece is found on the given square.
  */
 uint64_t findBitboard(const BoardState& board, int square, bool isWhite) {
-    uint64_t targetBit = (1ULL << square);
-
-    int start = isWhite ? WHITE_PAWNS : BLACK_PAWNS;
-    int end = isWhite ? WHITE_KINGS : BLACK_KINGS;
-
-    for (int pieceType = start; pieceType <= end; ++pieceType) {
-        uint64_t bitboard = board.getBitboard(pieceType);
-        if (bitboard & targetBit) {
-            return bitboard;  // Found the piece
-        }
+    int pieceType = board.pieceOn(square);
+    if (pieceType != NO_PIECE && (pieceType < BLACK_PAWNS) == isWhite) {
+        return board.getBitboard(pieceType);  // Found the piece
     }
 
     throw std::runtime_error("No piece found on the specified square!");
@@ -4,6 +4,9 @@ std::array<uint64_t, 64> king_threats_table;
 std::array<uint64_t, 64> knight_threats_table;
 std::array<uint64_t, 64> wpawn_threats_table;
 std::array<uint64_t, 64> bpawn_threats_table;
+std::array<std::array<uint64_t, 64>, 64> between_table;
+std::array<uint64_t, 64> rook_rays_table;
+std::array<uint64_t, 64> bishop_rays_table;
 
 // Helper function to pop the least significant bit and return its index
 inline int popLSB(uint64_t& bitboard) {
@@ -12,152 +15,6 @@ inline int popLSB(uint64_t& bitboard) {
     return index;
 }
 
-/*
-Generate a bitboard with 1s on every square between a king and a piece actively
-checking it, including the attacking piece, excluding the king.  and pass only enemy occupancy in the event
-of pin detection/enforcement.
-*/
-/**
- * Generates a bitboard representing the squares between a king and an attacking piece.
- *
- * - Includes all squares between the king and the attacker, plus the attacker's square.
- * - Used for detecting pins and identifying squares that must be blocked or the attacker captured.
- * - Distinguishes between diagonal and straight-line attacks.
- * - Uses the provided occupancy to determine attack paths.
- * - Ensures the king's square is included when necessary to prevent edge-case bugs.
- * - Pass allOccupancy in the event of blocking/capturing 
- * - Pass only enemy occupancy in the event of pin detection/enforcement.
- * @param kingSquare The square index of the king.
- * @param attackerSquare The square index of the attacking piece.
- * @param occupancy The occupancy bitboard (all pieces for blocking/capturing, enemy-only for pins).
- * @return A bitboard with 1s on all squares between the king and the attacker (including the
- * attacker).
- */
-static uint64_t generateRayMask(int kingSquare, int attackerSquare, uint64_t occupancy) {
-    // Create a bitboard where only the attacking piece is "occupied"
-    uint64_t attackerOnlyBoard = 1ULL << attackerSquare;
-
-    // Determine if the attack is along a diagonal or a straight line
-    bool isDiagonalAttack = (Bmagic(kingSquare, 0) & attackerOnlyBoard) != 0;
-
-    // Generate the ray from the king to the attacker based on the type of attack
-    uint64_t kingRayMask;
-    if (isDiagonalAttack) {
-        kingRayMask = Bmagic(kingSquare, attackerOnlyBoard);  // Diagonal ray
-    } else {
-        kingRayMask = Rmagic(kingSquare, attackerOnlyBoard);  // Rank/file ray
-    }
-
-    // Generate the attack mask of the attacker based on the passed-in occupancy
-    // We need to make sure that if this occupancy is only the enemy occupancy we
-    // include the king's square to prevent a bug in positions like this:
-    // https://i.imgur.com/25slm58.png
-    // If we pass the total occupancy this will do nothing.
-    uint64_t kingOnlyBoard = (1ULL << kingSquare);
-    occupancy |= kingOnlyBoard;
-    uint64_t attackerAttackMask =
-        isDiagonalAttack ? Bmagic(attackerSquare, occupancy) : Rmagic(attackerSquare, occupancy);
-
-    // Restrict the ray to the squares between the king and the attacker (including the attacker)
-    uint64_t rayMask = kingRayMask & attackerAttackMask;
-    rayMask |= (1ULL << attackerSquare);  // Include the attacker's square for capturing
-    return rayMask;
-}
-
-/**
- * Identifies the position of the attacking piece threatening the king.
- *
- * - Assumes there is exactly one attacker.
- * - Checks for attacks from knights, pawns, bishops, rooks, and queens.
- * - Uses precomputed attack tables and magic bitboard functions for efficiency.
- * - Throws an exception if no attacking piece is found, indicating a logic error.
- *
- * @param board The current board state.
- * @return The square index of the attacking piece.
- * @throws std::logic_error If no attacker is found (indicating a bug in the call logic).
- */
-static int findAttackerSquare(const BoardState& board) {
-    bool isWhite = board.getTurn();
-    uint64_t kingBB = board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS);
-
-    // Extract the king's position
-    int kingSquare = __builtin_ctzll(kingBB);
-
-    uint64_t allOccupancy = board.getAllOccupancy();
-
-    // Check for knight attacks
-    uint64_t knightAttacks = knight_threats_table[kingSquare];
-    uint64_t enemyKnights = board.getBitboard(isWhite ? BLACK_KNIGHTS : WHITE_KNIGHTS);
-    if (knightAttacks & enemyKnights) {
-        return __builtin_ctzll(knightAttacks & enemyKnights);
-    }
-
-    // Check for pawn attacks
-    uint64_t pawnAttacks =
-        isWhite ? wpawn_threats_table[kingSquare] : bpawn_threats_table[kingSquare];
-    uint64_t enemyPawns = board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS);
-    if (pawnAttacks & enemyPawns) {
-        return __builtin_ctzll(pawnAttacks & enemyPawns);
-    }
-
-    // Check for bishop/queen attacks
-    uint64_t bishopAttacks = Bmagic(kingSquare, allOccupancy);
-    uint64_t enemyBishopsQueens = board.getBitboard(isWhite ? BLACK_BISHOPS : WHITE_BISHOPS) |
-                                  board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
-    if (bishopAttacks & enemyBishopsQueens) {
-        return __builtin_ctzll(bishopAttacks & enemyBishopsQueens);
-    }
-    // Check for rook/queen attacks
-    uint64_t rookAttacks = Rmagic(kingSquare, allOccupancy);
-    uint64_t enemyRooksQueens = board.getBitboard(isWhite ? BLACK_ROOKS : WHITE_ROOKS) |
-                                board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
-    if (rookAttacks & enemyRooksQueens) {
-        return __builtin_ctzll(rookAttacks & enemyRooksQueens);
-    }
-
-    // If no attackers are found, throw an error
-    throw std::logic_error(
-        "No attacker found for the king. This function is only called when there is an attacker. "
-        "Something is wrong");
-}
-
-/**
- * Determines if a knight or pawn is delivering an immediate check to the king.
- *
- * - Checks for knight and pawn threats separately.
- * - Uses precomputed attack tables for efficiency.
- * - Returns a bitboard with the checking piece(s) if found.
- * - If no check is detected, returns 0.
- *
- * @param board The current board state.
- * @return A bitboard with the checking knight or pawn, or 0 if none exist.
- */
-static uint64_t isImmediateCheckByKnightOrPawn(const BoardState& board) {
-    // Determine if it's White's turn
-    bool isWhite = board.getTurn();
-
-    // Get the king's bitboard and extract its square
-    uint64_t kingBB = board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS);
-    int kingSquare = __builtin_ctzll(kingBB);
-
-    // Check knight attacks
-    uint64_t knightAttacks = knight_threats_table[kingSquare];  // Threats from all potential
-                                                                // knights to the king's square
-    uint64_t enemyKnights = board.getBitboard(isWhite ? BLACK_KNIGHTS : WHITE_KNIGHTS);
-    uint64_t attacker = knightAttacks & enemyKnights;
-    if (attacker) return attacker;
-
-    // Check pawn attacks
-    uint64_t pawnAttacks = isWhite ? wpawn_threats_table[kingSquare]
-                                   : bpawn_threats_table[kingSquare];  // Potential pawn threats
-    uint64_t enemyPawns = board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS);
-    attacker = pawnAttacks & enemyPawns;
-    if (attacker) return attacker;
-
-    // No check by knight or pawn
-    return 0;
-}
-
 /**
  * Initializes precomputed king threat masks.
  *
@@ -218,21 +75,24 @@ void initKnightThreatMasks() {
  *
  * - Generates bitboards for each square representing squares a pawn attacks.
  * - Used for detecting pawn threats and enforcing check detection.
+ * - A pawn on its side's last rank attacks nothing, which keeps the shifts in range:
+ *   the tables are also read for kings on the edge ranks.
  */
 void initPawnThreatMasks() {
     for (int square = 0; square < 64; ++square) {
         uint64_t white_threats = 0;
         uint64_t black_threats = 0;
 
+        int rank = square / 8;  // Row number (0-7)
         int file = square % 8;  // Column number (0-7)
 
         // White pawn threats (upward diagonals)
-        if (file > 0) white_threats |= (1ULL << (square + 7));  // Up-left
-        if (file < 7) white_threats |= (1ULL << (square + 9));  // Up-right
+        if (rank < 7 && file > 0) white_threats |= (1ULL << (square + 7));  // Up-left
+        if (rank < 7 && file < 7) white_threats |= (1ULL << (square + 9));  // Up-right
 
         // Black pawn threats (downward diagonals)
-        if (file > 0) black_threats |= (1ULL << (square - 9));  // Down-left
-        if (file < 7) black_threats |= (1ULL << (square - 7));  // Down-right
+        if (rank > 0 && file > 0) black_threats |= (1ULL << (square - 9));  // Down-left
+        if (rank > 0 && file < 7) black_threats |= (1ULL << (square - 7));  // Down-right
 
         // Store in the respective tables
         wpawn_threats_table[square] = white_threats;
@@ -287,215 +147,262 @@ uint64_t generateThreatMask(int pieceType, int attackerSquare, uint64_t allOccup
 }
 
 /**
- * Counts the number of pieces checking the king.
- *
- * - Iterates through all potential attackers and determines if they are delivering check.
- * - Used to determine whether the king is in check and how many attackers exist.
+ * Initializes the squares strictly between every pair of squares.
  *
- * @param board The current board state.
- * @return The number of pieces checking the king.
+ * - Only squares on a common rank, file or diagonal have squares between them; every
+ *   other pair (including adjacent squares and knight jumps) gets an empty mask.
+ * - Also stores the rook and bishop rays of every square on an empty board.
+ * - Used for check evasions (block or capture) and pin rays.
+ * - Needs the magic move tables, so it is called after `initmagicmoves`.
  */
-static int numCheckers(const BoardState& board) {
-    bool isWhite = board.getTurn();
-    // Get the king's bitboard and occupancy for the side to check
-    uint64_t kingBB = board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS);
-
-    // Get the opponent's bitboards
-    uint64_t opponentPawns = board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS);
-    uint64_t opponentKnights = board.getBitboard(isWhite ? BLACK_KNIGHTS : WHITE_KNIGHTS);
-    uint64_t opponentBishops = board.getBitboard(isWhite ? BLACK_BISHOPS : WHITE_BISHOPS);
-    uint64_t opponentRooks = board.getBitboard(isWhite ? BLACK_ROOKS : WHITE_ROOKS);
-    uint64_t opponentQueens = board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
-    uint64_t allOccupancy = board.getAllOccupancy();
-
-    // Select the appropriate threat table for pawns
-    const std::array<uint64_t, 64>& pawnThreatsTable =
-        isWhite ? bpawn_threats_table : wpawn_threats_table;
-    int checkers = 0;
-
-    // Check threats from opponent pawns
-    uint64_t remainingPawns = opponentPawns;
-    while (remainingPawns) {
-        int pawnSquare = popLSB(remainingPawns);
-        if (pawnThreatsTable[pawnSquare] & kingBB) {
-            checkers += 1;
-        }
-    }
-    // Check threats from opponent bishops and queens (diagonal attacks)
-    uint64_t bishopsAndQueens = opponentBishops | opponentQueens;
-    while (bishopsAndQueens) {
-        int square = popLSB(bishopsAndQueens);
-        if (Bmagic(square, allOccupancy) & kingBB) {
-            checkers += 1;
-        }
-    }
-
-    // Check threats from opponent rooks and queens (straight-line attacks)
-    uint64_t rooksAndQueens = opponentRooks | opponentQueens;
-    while (rooksAndQueens) {
-        int square = popLSB(rooksAndQueens);
-        if (Rmagic(square, allOccupancy) & kingBB) {
-            checkers += 1;
+void initBetweenMasks() {
+    for (int from = 0; from < 64; ++from) {
+        rook_rays_table[from] = Rmagic(from, 0);
+        bishop_rays_table[from] = Bmagic(from, 0);
+        for (int to = 0; to < 64; ++to) {
+            uint64_t fromMask = 1ULL << from;
+            uint64_t toMask = 1ULL << to;
+            uint64_t between = 0;
+            if (Rmagic(from, 0) & toMask) {
+                between = Rmagic(from, toMask) & Rmagic(to, fromMask);
+            } else if (Bmagic(from, 0) & toMask) {
+                between = Bmagic(from, toMask) & Bmagic(to, fromMask);
+            }
+            between_table[from][to] = between;
         }
     }
+}
 
-    // Check threats from opponent knights
-    uint64_t knights = opponentKnights;
-    while (knights) {
-        int knightSquare = popLSB(knights);
-        if (knight_threats_table[knightSquare] & kingBB) {
-            checkers += 1;
+/**
+ * Finds the pieces shielding a king from enemy sliders, and the sliders pinning them.
+ *
+ * - A blocker is the only piece (of either side) between the king and an enemy slider
+ *   aligned with it. Our blockers are pinned; enemy blockers can give discovered check.
+ * - Pinners are the sliders whose blocker belongs to the king's side.
+ *
+ * @param board The current board state.
+ * @param isWhite The side whose king is examined.
+ * @param blockers Set to the blockers of that king.
+ * @param pinners Set to the enemy sliders pinning one of that side's pieces.
+ */
+static void sliderBlockers(const BoardState& board, bool isWhite, uint64_t& blockers,
+                           uint64_t& pinners) {
+    int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+    uint64_t enemyQueens = board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
+    uint64_t enemyBishops = board.getBitboard(isWhite ? BLACK_BISHOPS : WHITE_BISHOPS);
+    uint64_t enemyRooks = board.getBitboard(isWhite ? BLACK_ROOKS : WHITE_ROOKS);
+
+    // Enemy sliders that would attack the king on an empty board
+    uint64_t snipers = (rook_rays_table[kingSquare] & (enemyRooks | enemyQueens)) |
+                       (bishop_rays_table[kingSquare] & (enemyBishops | enemyQueens));
+    uint64_t occupancy = board.getAllOccupancy() ^ snipers;
+
+    blockers = 0;
+    pinners = 0;
+    while (snipers) {
+        int sniperSquare = popLSB(snipers);
+        uint64_t between = between_table[kingSquare][sniperSquare] & occupancy;
+        if (between && !(between & (between - 1))) {
+            blockers |= between;
+            if (between & board.getOccupancy(isWhite)) pinners |= (1ULL << sniperSquare);
         }
     }
+}
 
+/**
+ * Computes the StateInfo of the current position.
+ *
+ * - Checkers come from a single attacks-to query on the king of the side to move.
+ * - Blockers and pinners are computed for both kings.
+ * - Check squares are where each piece kind of the side to move would attack the enemy
+ *   king from, with the current occupancy.
+ * - Called when a position is set up and by `applyMove` after pushing a fresh slot.
+ *
+ * @param board The board whose current StateInfo is filled in.
+ */
+void updateStateInfo(BoardState& board) {
+    StateInfo& state = board.stateInfo();
+    bool isWhite = board.getTurn();
+    uint64_t allOccupancy = board.getAllOccupancy();
 
-    // If no threats are found, the king is not in check
-    return checkers;
+    int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+    uint64_t enemyQueens = board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
+    uint64_t pawnAttacks =
+        isWhite ? wpawn_threats_table[kingSquare] : bpawn_threats_table[kingSquare];
+    state.checkers =
+        (pawnAttacks & board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS)) |
+        (knight_threats_table[kingSquare] &
+         board.getBitboard(isWhite ? BLACK_KNIGHTS : WHITE_KNIGHTS)) |
+        (Bmagic(kingSquare, allOccupancy) &
+         (board.getBitboard(isWhite ? BLACK_BISHOPS : WHITE_BISHOPS) | enemyQueens)) |
+        (Rmagic(kingSquare, allOccupancy) &
+         (board.getBitboard(isWhite ? BLACK_ROOKS : WHITE_ROOKS) | enemyQueens));
+
+    sliderBlockers(board, true, state.blockers[0], state.pinners[0]);
+    sliderBlockers(board, false, state.blockers[1], state.pinners[1]);
+
+    int enemyKingSquare = __builtin_ctzll(board.getBitboard(isWhite ? BLACK_KINGS : WHITE_KINGS));
+    uint64_t bishopChecks = Bmagic(enemyKingSquare, allOccupancy);
+    uint64_t rookChecks = Rmagic(enemyKingSquare, allOccupancy);
+    // Our pawns check from where an enemy pawn on the king's square would attack
+    state.checkSquares[WHITE_PAWNS] =
+        isWhite ? bpawn_threats_table[enemyKingSquare] : wpawn_threats_table[enemyKingSquare];
+    state.checkSquares[WHITE_KNIGHTS] = knight_threats_table[enemyKingSquare];
+    state.checkSquares[WHITE_BISHOPS] = bishopChecks;
+    state.checkSquares[WHITE_ROOKS] = rookChecks;
+    state.checkSquares[WHITE_QUEENS] = bishopChecks | rookChecks;
+    state.checkSquares[WHITE_KINGS] = 0;
 }
 
 /**
  * Determines whether the king is in check.
  *
- * - Similar to numCheckers but returns early upon detecting a check.
- * - More efficient when only a boolean result is needed.
+ * - Reads the checkers of the current StateInfo, computed when the position was reached.
  *
  * @param board The current board state.
  * @return True if the king is in check, false otherwise.
  */
 bool is_in_check(const BoardState& board) {
-    bool isWhite = board.getTurn();
-    // Get the king's bitboard and occupancy for the side to check
-    uint64_t kingBB = board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS);
-
-    // Get the opponent's bitboards
-    uint64_t opponentPawns = board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS);
-    uint64_t opponentKnights = board.getBitboard(isWhite ? BLACK_KNIGHTS : WHITE_KNIGHTS);
-    uint64_t opponentBishops = board.getBitboard(isWhite ? BLACK_BISHOPS : WHITE_BISHOPS);
-    uint64_t opponentRooks = board.getBitboard(isWhite ? BLACK_ROOKS : WHITE_ROOKS);
-    uint64_t opponentQueens = board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
-    uint64_t allOccupancy = board.getAllOccupancy();
+    return board.getCheckers() != 0;
+}
 
-    // Select the appropriate threat table for pawns
-    const std::array<uint64_t, 64>& pawnThreatsTable =
-        isWhite ? bpawn_threats_table : wpawn_threats_table;
-
-    // Check threats from opponent bishops and queens (diagonal attacks)
-    uint64_t bishopsAndQueens = opponentBishops | opponentQueens;
-    while (bishopsAndQueens) {
-        int square = popLSB(bishopsAndQueens);
-        if (Bmagic(square, allOccupancy) & kingBB) {
-            return true;
-        }
+/**
+ * Determines whether a legal move gives check, without making it.
+ *
+ * - Direct checks: the moved piece lands on one of its check squares.
+ * - Discovered checks: one of our blockers of the enemy king leaves the line to it.
+ * - Promotions check with the new piece, castling with the rook, and en passant can
+ *   also uncover a slider by removing the captured pawn.
+ *
+ * @param board The current board state.
+ * @param move A legal move in this position.
+ * @return True if the move gives check.
+ */
+bool givesCheck(const BoardState& board, uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    bool isWhite = board.getTurn();
+    const StateInfo& state = board.stateInfo();
+    uint64_t fromMask = 1ULL << fromSquare;
+    uint64_t toMask = 1ULL << toSquare;
+    int pieceType = board.pieceOn(fromSquare);
+
+    // Direct check
+    if (state.checkSquares[pieceType % 6] & toMask) {
+        return true;
     }
 
-    // Check threats from opponent rooks and queens (straight-line attacks)
-    uint64_t rooksAndQueens = opponentRooks | opponentQueens;
-    while (rooksAndQueens) {
-        int square = popLSB(rooksAndQueens);
-        if (Rmagic(square, allOccupancy) & kingBB) {
-            return true;
-        }
+    // Discovered check, unless the piece stays on the line between the king and the slider
+    uint64_t enemyKingBB = board.getBitboard(isWhite ? BLACK_KINGS : WHITE_KINGS);
+    int enemyKingSquare = __builtin_ctzll(enemyKingBB);
+    if ((state.blockers[isWhite ? 1 : 0] & fromMask) &&
+        !(between_table[enemyKingSquare][fromSquare] & toMask) &&
+        !(between_table[enemyKingSquare][toSquare] & fromMask)) {
+        return true;
     }
 
-    // Check threats from opponent knights
-    uint64_t knights = opponentKnights;
-    while (knights) {
-        int knightSquare = popLSB(knights);
-        if (knight_threats_table[knightSquare] & kingBB) {
-            return true;
+    switch (special) {
+        case PROMOTION_QUEEN:
+        case PROMOTION_KNIGHT:
+        case PROMOTION_ROOK:
+        case PROMOTION_BISHOP: {
+            int promotionType = getPromotedPieceType(special, isWhite);
+            uint64_t occupancy = board.getAllOccupancy() ^ fromMask;
+            return generateThreatMask(promotionType, toSquare, occupancy) & enemyKingBB;
+        }
+        case EN_PASSANT: {
+            // The captured pawn may have been the only piece shielding the king
+            int capturedSquare = isWhite ? toSquare - 8 : toSquare + 8;
+            uint64_t occupancy =
+                (board.getAllOccupancy() ^ fromMask ^ (1ULL << capturedSquare)) | toMask;
+            uint64_t queens = board.getBitboard(isWhite ? WHITE_QUEENS : BLACK_QUEENS);
+            uint64_t rooks = board.getBitboard(isWhite ? WHITE_ROOKS : BLACK_ROOKS);
+            uint64_t bishops = board.getBitboard(isWhite ? WHITE_BISHOPS : BLACK_BISHOPS);
+            return (Rmagic(enemyKingSquare, occupancy) & (rooks | queens)) ||
+                   (Bmagic(enemyKingSquare, occupancy) & (bishops | queens));
         }
+        case CASTLING_KINGSIDE:
+        case CASTLING_QUEENSIDE: {
+            // Only the rook can give check; the king cannot reach the enemy king
+            int rookFromSquare = special == CASTLING_KINGSIDE ? fromSquare + 3 : fromSquare - 4;
+            int rookToSquare = special == CASTLING_KINGSIDE ? toSquare - 1 : toSquare + 1;
+            uint64_t occupancy =
+                (board.getAllOccupancy() ^ fromMask ^ (1ULL << rookFromSquare)) | toMask |
+                (1ULL << rookToSquare);
+            return Rmagic(rookToSquare, occupancy) & enemyKingBB;
+        }
+        default:
+            return false;
     }
+}
+
+/*
+Pin rays of the side to move. A king can be pinned along at most eight lines, so the
+masks fit in a fixed array and detecting them never touches the heap.
+*/
+struct PinMasks {
+    uint64_t masks[8];
+    int count = 0;
 
-    // Check threats from opponent pawns
-    uint64_t remainingPawns = opponentPawns;
-    while (remainingPawns) {
-        int pawnSquare = popLSB(remainingPawns);
-        if (pawnThreatsTable[pawnSquare] & kingBB) {
-            return true;
+    bool empty() const { return count == 0; }
+};
+
+/**
+ * Returns the pin mask of the piece on a square and drops it from the list.
+ *
+ * - Each pinned piece is looked up once, so removing its mask keeps later lookups short.
+ *
+ * @param pinMasks The pin masks still unused.
+ * @param square The square of the piece being generated.
+ * @return The pin mask of the piece, or all squares if it is not pinned.
+ */
+static uint64_t takePinMask(PinMasks& pinMasks, int square) {
+    for (int i = 0; i < pinMasks.count; ++i) {
+        if (pinMasks.masks[i] & (1ULL << square)) {
+            uint64_t pinMask = pinMasks.masks[i];
+            pinMasks.masks[i] = pinMasks.masks[--pinMasks.count];
+            return pinMask;
         }
     }
-
-    // If no threats are found, the king is not in check
-    return false;
+    return ~0ULL;
 }
 
 /**
  * Detects and returns pin masks for all pinned pieces.
  *
- * - Identifies pieces that are pinned to their king by enemy sliding pieces.
- * - Returns a vector of bitboards, each representing the squares a pinned piece
- * - can move to without breaking the pin.
+ * - Takes the pinners of the side to move from the current StateInfo.
+ * - Returns a list of bitboards, each representing the squares a pinned piece
+ * - can move to without breaking the pin: the ray to the pinner, pinner included.
  * - The mask is not necessarily all the legal moves the piece can do, just
  * - the moves that don't break the pin.
- * 
- * @param kingSquare The square of the king.
- * @param enemyOccupancy Bitboard of enemy pieces.
- * @param enemyQueens Bitboard of enemy queens.
- * @param enemyBishops Bitboard of enemy bishops.
- * @param enemyRooks Bitboard of enemy rooks.
- * @param alliedOccupancy Bitboard of allied pieces.
- * @return A vector of bitboards, each representing a pinned piece's legal movement mask.
+ *
+ * @param board The current board state.
+ * @return The bitboards, each representing a pinned piece's legal movement mask.
  */
-static std::vector<uint64_t> detectPinnedPieces(int kingSquare, uint64_t enemyOccupancy,
-                                                uint64_t enemyQueens, uint64_t enemyBishops,
-                                                uint64_t enemyRooks, uint64_t alliedOccupancy) {
-    std::vector<uint64_t> pinMasks;  // To store pin masks for pinned pieces
-
-    // Diagonal (bishop and queen) attacks
-    // King's diagonal attacks
-    uint64_t bishopAttackMask = Bmagic(kingSquare, enemyOccupancy);
-    // Only bishops/queens
-    uint64_t diagonalAttackers = bishopAttackMask & (enemyBishops | enemyQueens);
-    while (diagonalAttackers) {
-        int attackerSquare = popLSB(diagonalAttackers);
-
-        // Generate ray between the king and attacker
-        uint64_t rayMask = generateRayMask(kingSquare, attackerSquare, enemyOccupancy);
-        rayMask |= (1ULL << attackerSquare);  // Include attacker square
-
-        // Find allied pieces on this ray
-        uint64_t pinnedPieces = rayMask & alliedOccupancy;
-
-        if (__builtin_popcountll(pinnedPieces) == 1) {
-            pinMasks.push_back(rayMask);  // Add pin mask for a single pinned piece
-        }
-    }
-
-    // Straight-line (rook and queen) attacks
-    uint64_t rookAttackMask = Rmagic(kingSquare, enemyOccupancy);  // King's straight-line attacks
-    uint64_t straightAttackers = rookAttackMask & (enemyRooks | enemyQueens);  // Only rooks/queens
-
-
-    while (straightAttackers) {
-        int attackerSquare = popLSB(straightAttackers);
-
-        // Generate ray between the king and attacker
-        uint64_t rayMask = generateRayMask(kingSquare, attackerSquare, enemyOccupancy);
-        rayMask |= (1ULL << attackerSquare);  // Include attacker square
-
-        // Find allied pieces on this ray
-        uint64_t pinnedPieces = rayMask & alliedOccupancy;
-
-        if (__builtin_popcountll(pinnedPieces) == 1) {
-            pinMasks.push_back(rayMask);  // Add pin mask for a single pinned piece
-        }
+static PinMasks detectPinnedPieces(const BoardState& board) {
+    PinMasks pinMasks;  // To store pin masks for pinned pieces
+    bool isWhite = board.getTurn();
+    int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+    uint64_t pinners = board.stateInfo().pinners[isWhite ? 0 : 1];
+    while (pinners) {
+        int pinnerSquare = popLSB(pinners);
+        pinMasks.masks[pinMasks.count++] = between_table[kingSquare][pinnerSquare] |
+                                           (1ULL << pinnerSquare);
     }
-    return pinMasks;  // Return all pin masks
+    return pinMasks;
 }
 
 /**
- * Generates a vector of encoded king moves, excluding castling.
+ * Generates the encoded king moves, excluding castling.
  *
  * - Uses precomputed king move tables.
  * - Filters out illegal moves based on board occupancy.
  * - Can be used in both check and non-check scenarios.
  *
  * @param board The current board state.
- * @return A vector of encoded uint16_t king moves.
+ * @param moves The list the king moves are appended to.
  */
-std::vector<uint16_t> generateKingMoves(const BoardState& board) {
-    std::vector<uint16_t> legalKingMoves;
-
+void generateKingMoves(const BoardState& board, MoveList& moves) {
     // Determine the side to move
     bool isWhite = board.getTurn();
 
@@ -532,25 +439,21 @@ std::vector<uint16_t> generateKingMoves(const BoardState& board) {
     while (kingMoves) {
         int toSquare = popLSB(kingMoves);
         uint16_t move = encodeMove(kingSquare, toSquare);
-        legalKingMoves.push_back(move);
+        moves.push_back(move);
     }
-
-    return legalKingMoves;
 }
 
 /**
- * Generates a vector of legal castling moves.
+ * Generates the legal castling moves.
  *
  * - Checks whether castling is allowed based on board state.
  * - Ensures the squares between the king and rook are unoccupied.
  * - Ensures the king does not castle through or into check.
  *
  * @param board The current board state.
- * @return A vector of encoded uint16_t castling moves.
+ * @param moves The list the castling moves are appended to.
  */
-static std::vector<uint16_t> generateCastlingMoves(const BoardState& board) {
-    std::vector<uint16_t> castlingMoves;
-
+static void generateCastlingMoves(const BoardState& board, MoveList& moves) {
     // Determine the side to move
     bool isWhite = board.getTurn();
 
@@ -560,7 +463,7 @@ static std::vector<uint16_t> generateCastlingMoves(const BoardState& board) {
 
     // Early return if no castling rights
     if (!canCastleKingside && !canCastleQueenside) {
-        return castlingMoves;
+        return;
     }
 
     // King and rook positions
@@ -572,6 +475,9 @@ static std::vector<uint16_t> generateCastlingMoves(const BoardState& board) {
     uint64_t queensideMask =
         isWhite ? (1ULL << 1) | (1ULL << 2) | (1ULL << 3)
                 : (1ULL << 57) | (1ULL << 58) | (1ULL << 59);  // b1, c1, d1 or b8, c8, d8
+    // The king never crosses b1/b8, so only c and d need to be safe
+    uint64_t queensidePathMask =
+        isWhite ? (1ULL << 2) | (1ULL << 3) : (1ULL << 58) | (1ULL << 59);  // c1, d1 or c8, d8
 
     // Allied and enemy occupancies
     uint64_t allOccupancy = board.getAllOccupancy();
@@ -596,7 +502,7 @@ static std::vector<uint16_t> generateCastlingMoves(const BoardState& board) {
             if (!(kingsideMask & enemyAttackMask)) {
                 uint16_t kingsideCastleMove =
                     encodeMove(kingSquare, isWhite ? 6 : 62, CASTLING_KINGSIDE);  // e1g1 or e8g8
-                castlingMoves.push_back(kingsideCastleMove);
+                moves.push_back(kingsideCastleMove);
             }
         }
     }
@@ -606,15 +512,13 @@ static std::vector<uint16_t> generateCastlingMoves(const BoardState& board) {
         // Ensure squares between king and rook are empty
         if (!(queensideMask & allOccupancy)) {
             // Ensure those squares are not under attack
-            if (!(queensideMask & enemyAttackMask)) {
+            if (!(queensidePathMask & enemyAttackMask)) {
                 uint16_t queensideCastleMove =
                     encodeMove(kingSquare, isWhite ? 2 : 58, CASTLING_QUEENSIDE);  // e1c1 or e8c8
-                castlingMoves.push_back(queensideCastleMove);
+                moves.push_back(queensideCastleMove);
             }
         }
     }
-
-    return castlingMoves;
 }
 
 /**
@@ -675,7 +579,8 @@ static uint64_t generatePawnBitboard(
     }
 
     // Capture moves
-    std::array<uint64_t, 64> pawnThreatsTable = isWhite ? wpawn_threats_table : bpawn_threats_table;
+    const std::array<uint64_t, 64>& pawnThreatsTable =
+        isWhite ? wpawn_threats_table : bpawn_threats_table;
     uint64_t enPassantMask = enPassantSquare != NO_EN_PASSANT ? (1ULL << enPassantSquare) : 0;
     uint64_t captures = pawnThreatsTable[pawnSquare] & (enemyOccupancy | enPassantMask);
     moves |= captures;
@@ -683,7 +588,7 @@ static uint64_t generatePawnBitboard(
 }
 
 /**
- * Converts a pawn move bitboard into a vector of encoded moves.
+ * Converts a pawn move bitboard into encoded moves.
  *
  * - Takes a bitboard of possible pawn moves and encodes them into uint16_t format.
  * - Used after generating the pawn move bitboard to create move lists.
@@ -692,11 +597,10 @@ static uint64_t generatePawnBitboard(
  * @param pawn_square The square of the pawn.
  * @param move_bitboard A bitboard of valid pawn moves.
  * @param epsquare The en passant target square (-1 if none).
- * @return A vector of encoded uint16_t pawn moves.
+ * @param encoded_moves The list the pawn moves are appended to.
  */
-static std::vector<uint16_t> pawnBitboardToMoves(int pawn_square, uint64_t move_bitboard, uint8_t epsquare) {
-    std::vector<uint16_t> encoded_moves;
-
+static void pawnBitboardToMoves(int pawn_square, uint64_t move_bitboard, uint8_t epsquare,
+                                MoveList& encoded_moves) {
     while (move_bitboard) {
         int dest_square = popLSB(move_bitboard);
 
@@ -717,8 +621,6 @@ static std::vector<uint16_t> pawnBitboardToMoves(int pawn_square, uint64_t move_
                 encodeMove(pawn_square, dest_square, SPECIAL_NONE));  // No promotion or special
         }
     }
-
-    return encoded_moves;
 }
 
 /**
@@ -728,10 +630,9 @@ static std::vector<uint16_t> pawnBitboardToMoves(int pawn_square, uint64_t move_
  * - Assumes there's no pinned pieces and we are not in check.
  *
  * @param board The current board state.
- * @return A vector of encoded uint16_t pseudo-legal moves.
+ * @param legalMoves The list the moves are appended to.
  */
-static std::vector<uint16_t> generateMovesNoCheckNoPins(const BoardState& board) {
-    std::vector<uint16_t> legalMoves;
+static void generateMovesNoCheckNoPins(const BoardState& board, MoveList& legalMoves) {
     bool isWhite = board.getTurn();
     int knights = isWhite ? WHITE_KNIGHTS : BLACK_KNIGHTS;
     int queens = isWhite ? WHITE_QUEENS : BLACK_QUEENS;
@@ -759,22 +660,17 @@ static std::vector<uint16_t> generateMovesNoCheckNoPins(const BoardState& board)
         uint64_t enemyOccupancy = board.getOccupancy(!isWhite);
 
         uint64_t pawnMoves = generatePawnBitboard(
-            pawnSquare, enemyOccupancy, board.getAllOccupancy(), board.getEnPassant(), isWhite);
+            pawnSquare, enemyOccupancy, board.getAllOccupancy(), NO_EN_PASSANT, isWhite);
 
         // Use the helper function to convert the bitboard to encoded moves
-        std::vector<uint16_t> pawnMoveList = pawnBitboardToMoves(pawnSquare, pawnMoves, board.getEnPassant());
-        legalMoves.insert(legalMoves.end(), pawnMoveList.begin(), pawnMoveList.end());
+        pawnBitboardToMoves(pawnSquare, pawnMoves, NO_EN_PASSANT, legalMoves);
     }
 
     // Add king moves
-    std::vector<uint16_t> kingMoves = generateKingMoves(board);
-    legalMoves.insert(legalMoves.end(), kingMoves.begin(), kingMoves.end());
+    generateKingMoves(board, legalMoves);
 
     // Add castling moves
-    std::vector<uint16_t> castlingMoves = generateCastlingMoves(board);
-    legalMoves.insert(legalMoves.end(), castlingMoves.begin(), castlingMoves.end());
-
-    return legalMoves;
+    generateCastlingMoves(board, legalMoves);
 }
 
 /**
@@ -782,12 +678,11 @@ static std::vector<uint16_t> generateMovesNoCheckNoPins(const BoardState& board)
  * we are not in check.
  *
  * @param board The current board state.
- * @param pinMasks A vector of pin masks restricting pinned pieces.
- * @return A vector of encoded uint16_t pseudo-legal moves.
+ * @param pinMasks The pin masks restricting pinned pieces.
+ * @param legalMoves The list the moves are appended to.
  */
-static std::vector<uint16_t> generateMovesNoCheckWithPins(const BoardState& board,
-                                                          std::vector<uint64_t>& pinMasks) {
-    std::vector<uint16_t> legalMoves;
+static void generateMovesNoCheckWithPins(const BoardState& board, PinMasks& pinMasks,
+                                         MoveList& legalMoves) {
 
     // Determine whose turn it is
     bool isWhite = board.getTurn();
@@ -797,8 +692,8 @@ static std::vector<uint16_t> generateMovesNoCheckWithPins(const BoardState& boar
 
     // Generate a bitboard of all pinned pieces
     uint64_t pinnedPieces = 0;
-    for (uint64_t pinMask : pinMasks) {
-        pinnedPieces |= (pinMask & alliedOccupancy);
+    for (int i = 0; i < pinMasks.count; ++i) {
+        pinnedPieces |= (pinMasks.masks[i] & alliedOccupancy);
     }
 
     // Generate moves for all pieces except pawns and king
@@ -812,14 +707,7 @@ static std::vector<uint16_t> generateMovesNoCheckWithPins(const BoardState& boar
 
             // Apply pin restrictions if the piece is pinned
             if (pinnedPieces & (1ULL << fromSquare)) {
-                // Find and remove the specific pin mask for this piece
-                for (auto it = pinMasks.begin(); it != pinMasks.end(); ++it) {
-                    if (*it & (1ULL << fromSquare)) {
-                        legalDestinations &= *it;
-                        pinMasks.erase(it);  // Remove the pin mask after using it
-                        break;
-                    }
-                }
+                legalDestinations &= takePinMask(pinMasks, fromSquare);
             }
 
             // Add legal moves
@@ -837,33 +725,21 @@ static std::vector<uint16_t> generateMovesNoCheckWithPins(const BoardState& boar
         uint64_t enemyOccupancy = board.getOccupancy(!isWhite);
 
         uint64_t pawnMoves = generatePawnBitboard(
-            pawnSquare, enemyOccupancy, board.getAllOccupancy(), board.getEnPassant(), isWhite);
+            pawnSquare, enemyOccupancy, board.getAllOccupancy(), NO_EN_PASSANT, isWhite);
 
         // Apply pin restrictions if the pawn is pinned
         if (pinnedPieces & (1ULL << pawnSquare)) {
-            // Find and remove the specific pin mask for this piece
-            for (auto it = pinMasks.begin(); it != pinMasks.end(); ++it) {
-                if (*it & (1ULL << pawnSquare)) {
-                    pawnMoves &= *it;
-                    pinMasks.erase(it);  // Remove the pin mask after using it
-                    break;
-                }
-            }
+            pawnMoves &= takePinMask(pinMasks, pawnSquare);
         }
         // Use helper function to handle pawn moves
-        std::vector<uint16_t> pawnMoveList = pawnBitboardToMoves(pawnSquare, pawnMoves, board.getEnPassant());
-        legalMoves.insert(legalMoves.end(), pawnMoveList.begin(), pawnMoveList.end());
+        pawnBitboardToMoves(pawnSquare, pawnMoves, NO_EN_PASSANT, legalMoves);
     }
 
     // Add king moves
-    std::vector<uint16_t> kingMoves = generateKingMoves(board);
-    legalMoves.insert(legalMoves.end(), kingMoves.begin(), kingMoves.end());
+    generateKingMoves(board, legalMoves);
 
     // Add castling moves
-    std::vector<uint16_t> castlingMoves = generateCastlingMoves(board);
-    legalMoves.insert(legalMoves.end(), castlingMoves.begin(), castlingMoves.end());
-
-    return legalMoves;
+    generateCastlingMoves(board, legalMoves);
 }
 
 /**
@@ -873,26 +749,18 @@ static std::vector<uint16_t> generateMovesNoCheckWithPins(const BoardState& boar
  * - This comes out to be only blocks, captures, or moving the king, but not castling.
  *
  * @param board The current board state.
- * @return A vector of encoded uint16_t legal moves in a single-check scenario.
+ * @param legalMoves The list the moves are appended to.
  */
-static std::vector<uint16_t> generateMovesSingleCheckNoPins(const BoardState& board) {
-    std::vector<uint16_t> legalMoves;
-
+static void generateMovesSingleCheckNoPins(const BoardState& board, MoveList& legalMoves) {
     bool isWhite = board.getTurn();
     uint64_t kingBB = board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS);
 
     int kingSquare = __builtin_ctzll(kingBB);
 
-    // Grab the bitboard including only the checking knight/pawn.
-    uint64_t attackerBitBoard = isImmediateCheckByKnightOrPawn(board);
-
-    // Grab the int for the square number this piece is on.
-    int attackerSquare = findAttackerSquare(board);
-
-    // If the
-    uint64_t blockOrCaptureMask =
-        attackerBitBoard ? attackerBitBoard  // Mask for knight or pawn check
-                         : generateRayMask(kingSquare, attackerSquare, board.getAllOccupancy());
+    // Capture the checker, or block it if it is a slider (nothing lies between a king and
+    // a checking knight or pawn)
+    uint64_t checkers = board.getCheckers();
+    uint64_t blockOrCaptureMask = between_table[kingSquare][__builtin_ctzll(checkers)] | checkers;
 
     int knights = isWhite ? WHITE_KNIGHTS : BLACK_KNIGHTS;
     int queens = isWhite ? WHITE_QUEENS : BLACK_QUEENS;
@@ -919,31 +787,26 @@ static std::vector<uint16_t> generateMovesSingleCheckNoPins(const BoardState& bo
         int pawnSquare = popLSB(pawnsBB);
         uint64_t pawnMoves =
             generatePawnBitboard(pawnSquare, enemyOccupancy, board.getAllOccupancy(),
-                                 board.getEnPassant(), isWhite) &
+                                 NO_EN_PASSANT, isWhite) &
             blockOrCaptureMask;
 
         // Use helper function to convert to encoded moves
-        std::vector<uint16_t> pawnMoveList = pawnBitboardToMoves(pawnSquare, pawnMoves, board.getEnPassant());
-        legalMoves.insert(legalMoves.end(), pawnMoveList.begin(), pawnMoveList.end());
+        pawnBitboardToMoves(pawnSquare, pawnMoves, NO_EN_PASSANT, legalMoves);
     }
 
     // Add king moves
-    std::vector<uint16_t> kingMoves = generateKingMoves(board);
-    legalMoves.insert(legalMoves.end(), kingMoves.begin(), kingMoves.end());
-
-    return legalMoves;
+    generateKingMoves(board, legalMoves);
 }
 
 /**
  * Generates all potential moves when the king is in check by a single piece and there is a pinned piece.
  *
  * @param board The current board state.
- * @param pinMasks A vector of pin masks restricting pinned pieces.
- * @return A vector of encoded uint16_t legal moves in a single-check scenario.
+ * @param pinMasks The pin masks restricting pinned pieces.
+ * @param legalMoves The list the moves are appended to.
  */
-static std::vector<uint16_t> generateMovesSingleCheckWithPins(const BoardState& board,
-                                                              std::vector<uint64_t>& pinMasks) {
-    std::vector<uint16_t> legalMoves;
+static void generateMovesSingleCheckWithPins(const BoardState& board, PinMasks& pinMasks,
+                                             MoveList& legalMoves) {
         // Use getTurn to determine whose turn it is
     bool isWhite = board.getTurn();
 
@@ -951,16 +814,10 @@ static std::vector<uint16_t> generateMovesSingleCheckWithPins(const BoardState&
     // Extract the king's position
     int kingSquare = __builtin_ctzll(kingBB);
 
-    // Grab the bitboard including only the checking knight/pawn.
-    uint64_t attackerBitBoard = isImmediateCheckByKnightOrPawn(board);
-
-    // Grab the int for the square number this piece is on.
-    int attackerSquare = findAttackerSquare(board);
-
-    // If the
-    uint64_t blockOrCaptureMask =
-        attackerBitBoard ? attackerBitBoard  // Mask for knight or pawn check
-                         : generateRayMask(kingSquare, attackerSquare, board.getAllOccupancy());
+    // Capture the checker, or block it if it is a slider (nothing lies between a king and
+    // a checking knight or pawn)
+    uint64_t checkers = board.getCheckers();
+    uint64_t blockOrCaptureMask = between_table[kingSquare][__builtin_ctzll(checkers)] | checkers;
 
     uint64_t enemyOccupancy = board.getOccupancy(!isWhite);
 
@@ -975,16 +832,7 @@ static std::vector<uint16_t> generateMovesSingleCheckWithPins(const BoardState&
                 blockOrCaptureMask;
 
             // Check if the piece is pinned and restrict its legal moves accordingly
-            for (size_t i = 0; i < pinMasks.size(); ++i) {
-                uint64_t pinMask = pinMasks[i];
-                if (pinMask & (1ULL << fromSquare)) {
-                    // Restrict the legal destinations based on the pin mask
-                    legalDestinations &= pinMask;
-                    // Remove the pin mask from the vector, no need to check it again
-                    pinMasks.erase(pinMasks.begin() + i);
-                    break;  // No need to check other pin masks after using this one
-                }
-            }
+            legalDestinations &= takePinMask(pinMasks, fromSquare);
 
             // Add valid moves for the piece
             while (legalDestinations) {
@@ -1000,96 +848,343 @@ static std::vector<uint16_t> generateMovesSingleCheckWithPins(const BoardState&
         int pawnSquare = popLSB(pawnsBB);
         uint64_t pawnMoves =
             generatePawnBitboard(pawnSquare, enemyOccupancy, board.getAllOccupancy(),
-                                 board.getEnPassant(), isWhite) &
+                                 NO_EN_PASSANT, isWhite) &
             blockOrCaptureMask;
 
         // Check if the pawn is pinned
-        for (size_t i = 0; i < pinMasks.size(); ++i) {
-            uint64_t pinMask = pinMasks[i];
-            if (pinMask & (1ULL << pawnSquare)) {
-                // Restrict the pawn's legal moves based on the pin mask
-                pawnMoves &= pinMask;
-                // Remove the pin mask from the vector, no need to check it again
-                pinMasks.erase(pinMasks.begin() + i);
-                break;  // No need to check other pin masks after using this one
-            }
-        }
+        pawnMoves &= takePinMask(pinMasks, pawnSquare);
 
         // Convert pawn moves from bitboard to encoded moves
-        std::vector<uint16_t> pawnMoveList = pawnBitboardToMoves(pawnSquare, pawnMoves, board.getEnPassant());
-        legalMoves.insert(legalMoves.end(), pawnMoveList.begin(), pawnMoveList.end());
+        pawnBitboardToMoves(pawnSquare, pawnMoves, NO_EN_PASSANT, legalMoves);
     }
 
     // Add king moves
-    std::vector<uint16_t> kingMoves = generateKingMoves(board);
-    legalMoves.insert(legalMoves.end(), kingMoves.begin(), kingMoves.end());
+    generateKingMoves(board, legalMoves);
+}
 
-    return legalMoves;
+/**
+ * Checks whether an en passant capture leaves the mover's king safe.
+ *
+ * - En passant removes two pawns from one rank, so it can expose the king along that rank
+ *   (or a diagonal) in ways the pin masks cannot see. The position after the capture is
+ *   checked directly instead.
+ * - Also decides whether the capture answers a check: it must remove or block every checker.
+ *
+ * @param board The current board state.
+ * @param fromSquare The square of the capturing pawn.
+ * @param epSquare The en passant target square.
+ * @return True if the capture is legal.
+ */
+static bool isLegalEnPassant(const BoardState& board, int fromSquare, int epSquare) {
+    bool isWhite = board.getTurn();
+    int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+    int capturedSquare = isWhite ? epSquare - 8 : epSquare + 8;
+
+    uint64_t occupancy = (board.getAllOccupancy() ^ (1ULL << fromSquare) ^
+                          (1ULL << capturedSquare)) | (1ULL << epSquare);
+    uint64_t enemyQueens = board.getBitboard(isWhite ? BLACK_QUEENS : WHITE_QUEENS);
+    uint64_t enemyBishops = board.getBitboard(isWhite ? BLACK_BISHOPS : WHITE_BISHOPS);
+    uint64_t enemyRooks = board.getBitboard(isWhite ? BLACK_ROOKS : WHITE_ROOKS);
+    uint64_t enemyKnights = board.getBitboard(isWhite ? BLACK_KNIGHTS : WHITE_KNIGHTS);
+    uint64_t enemyPawns =
+        board.getBitboard(isWhite ? BLACK_PAWNS : WHITE_PAWNS) & ~(1ULL << capturedSquare);
+    uint64_t pawnAttacks =
+        isWhite ? wpawn_threats_table[kingSquare] : bpawn_threats_table[kingSquare];
+
+    return !(Bmagic(kingSquare, occupancy) & (enemyBishops | enemyQueens)) &&
+           !(Rmagic(kingSquare, occupancy) & (enemyRooks | enemyQueens)) &&
+           !(knight_threats_table[kingSquare] & enemyKnights) && !(pawnAttacks & enemyPawns);
+}
+
+/**
+ * Generates the legal en passant captures, if any.
+ *
+ * @param board The current board state.
+ * @param moves The list the en passant moves are appended to.
+ */
+static void generateEnPassantMoves(const BoardState& board, MoveList& moves) {
+    int epSquare = board.getEnPassant();
+    if (epSquare == NO_EN_PASSANT) return;
+
+    bool isWhite = board.getTurn();
+    // Our pawns that attack the target square stand where an enemy pawn on it would attack
+    uint64_t capturers = (isWhite ? bpawn_threats_table[epSquare] : wpawn_threats_table[epSquare]) &
+                         board.getBitboard(isWhite ? WHITE_PAWNS : BLACK_PAWNS);
+    while (capturers) {
+        int fromSquare = popLSB(capturers);
+        if (isLegalEnPassant(board, fromSquare, epSquare)) {
+            moves.push_back(encodeMove(fromSquare, epSquare, EN_PASSANT));
+        }
+    }
 }
 
 /**
  * Generates all fully legal moves for the current position.
  *
  * - Accounts for checks, pins, and all movement restrictions.
- * - Determines the number of attackers checking the king.
+ * - Reads the checkers and pinners from the position's StateInfo.
  * - Calls the appropriate move generation function based on check and pin status.
+ * - En passant captures are left out of those and generated separately with a full
+ *   legality check, since pins and check evasions work differently for them.
  *
  * @param board The current board state.
- * @return A vector of encoded uint16_t fully legal moves.
+ * @return The list of encoded uint16_t fully legal moves.
  */
-std::vector<uint16_t> allLegalMoves(const BoardState& board) {
+MoveList allLegalMoves(const BoardState& board) {
     // Determine the number of attackers
-    int attacking_pieces = numCheckers(board);  // Returns 0, 1, or 2
-    std::vector<uint16_t> legalMoves;
-    bool isWhite = board.getTurn();
-    uint64_t kingBB = board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS);
-
-    // Extract the king's position
-    int kingSquare = __builtin_ctzll(kingBB);
-    uint64_t enemyOccupancy = board.getOccupancy(!isWhite);
-    uint64_t alliedOccupancy = board.getOccupancy(isWhite);
-
-    uint64_t enemyQueens =
-        isWhite ? board.getBitboard(BLACK_QUEENS) : board.getBitboard(WHITE_QUEENS);
-    uint64_t enemyRooks = isWhite ? board.getBitboard(BLACK_ROOKS) : board.getBitboard(WHITE_ROOKS);
-    uint64_t enemyBishops =
-        isWhite ? board.getBitboard(BLACK_BISHOPS) : board.getBitboard(WHITE_BISHOPS);
+    int attacking_pieces = __builtin_popcountll(board.getCheckers());  // 0, 1, or 2
+    MoveList legalMoves;
 
     // Case 1: No checks (attacking_pieces == 0)
     if (attacking_pieces == 0) {
         // Detect pinned pieces
-        std::vector<uint64_t> pinMasks = detectPinnedPieces(
-            kingSquare, enemyOccupancy, enemyQueens, enemyBishops, enemyRooks, alliedOccupancy);
+        PinMasks pinMasks = detectPinnedPieces(board);
 
         // If there are no pinned pieces, generate moves without checks or pins
         if (pinMasks.empty()) {
-            legalMoves = generateMovesNoCheckNoPins(board);
+            generateMovesNoCheckNoPins(board, legalMoves);
         } else {
             // Otherwise, generate moves considering pins
-            legalMoves = generateMovesNoCheckWithPins(board, pinMasks);
+            generateMovesNoCheckWithPins(board, pinMasks, legalMoves);
         }
 
     }
     // Case 2: Single check (attacking_pieces == 1)
     else if (attacking_pieces == 1) {
         // Detect pinned pieces
-        std::vector<uint64_t> pinMasks = detectPinnedPieces(
-            kingSquare, enemyOccupancy, enemyQueens, enemyBishops, enemyRooks, alliedOccupancy);
+        PinMasks pinMasks = detectPinnedPieces(board);
 
         // If there are no pinned pieces, generate moves considering 1 check and no pins
         if (pinMasks.empty()) {
-            legalMoves = generateMovesSingleCheckNoPins(board);
+            generateMovesSingleCheckNoPins(board, legalMoves);
         } else {
             // Otherwise, generate moves considering 1 check with pins
-            legalMoves = generateMovesSingleCheckWithPins(board, pinMasks);
+            generateMovesSingleCheckWithPins(board, pinMasks, legalMoves);
         }
 
     }
     // Case 3: Double check (attacking_pieces == 2)
     else {
         // In a double check, only the king can move
-        legalMoves = generateKingMoves(board);
+        generateKingMoves(board, legalMoves);
     }
 
+    generateEnPassantMoves(board, legalMoves);
+
     return legalMoves;
 }
+
+/**
+ * Generates the legal captures and promotions, for quiescence search.
+ *
+ * - Only for positions that are not in check; evasions come from `allLegalMoves`.
+ * - Captures by every piece, en passant, and promotions. A promotion by capture comes in
+ *   all four kinds, one by a push only as a queen.
+ * - Quiet moves are never generated, and the king's escape squares are only worked out
+ *   when it has something to capture.
+ *
+ * @param board The current board state.
+ * @return The list of encoded uint16_t legal captures and promotions.
+ */
+MoveList allLegalCaptures(const BoardState& board) {
+    bool isWhite = board.getTurn();
+    MoveList captures;
+    PinMasks pinMasks = detectPinnedPieces(board);
+    uint64_t alliedOccupancy = board.getOccupancy(isWhite);
+    uint64_t enemyOccupancy = board.getOccupancy(!isWhite);
+    uint64_t allOccupancy = board.getAllOccupancy();
+
+    uint64_t pinnedPieces = 0;
+    for (int i = 0; i < pinMasks.count; ++i) {
+        pinnedPieces |= (pinMasks.masks[i] & alliedOccupancy);
+    }
+
+    // Knights to queens
+    for (int pieceType = (isWhite ? WHITE_KNIGHTS : BLACK_KNIGHTS);
+         pieceType <= (isWhite ? WHITE_QUEENS : BLACK_QUEENS); ++pieceType) {
+        uint64_t pieceBB = board.getBitboard(pieceType);
+        while (pieceBB) {
+            int fromSquare = popLSB(pieceBB);
+            uint64_t targets = generateThreatMask(pieceType, fromSquare, allOccupancy) &
+                               enemyOccupancy;
+            if (pinnedPieces & (1ULL << fromSquare)) {
+                targets &= takePinMask(pinMasks, fromSquare);
+            }
+            while (targets) {
+                captures.push_back(encodeMove(fromSquare, popLSB(targets)));
+            }
+        }
+    }
+
+    // Pawn captures, and pushes onto the last rank
+    const std::array<uint64_t, 64>& pawnThreatsTable =
+        isWhite ? wpawn_threats_table : bpawn_threats_table;
+    uint64_t lastRank = isWhite ? 0xFF00000000000000ULL : 0xFFULL;
+    uint64_t pawnsBB = board.getBitboard(isWhite ? WHITE_PAWNS : BLACK_PAWNS);
+    while (pawnsBB) {
+        int pawnSquare = popLSB(pawnsBB);
+        uint64_t targets = pawnThreatsTable[pawnSquare] & enemyOccupancy;
+        uint64_t push = 1ULL << (isWhite ? pawnSquare + 8 : pawnSquare - 8);
+        push &= lastRank & ~allOccupancy;
+        if (pinnedPieces & (1ULL << pawnSquare)) {
+            uint64_t pinMask = takePinMask(pinMasks, pawnSquare);
+            targets &= pinMask;
+            push &= pinMask;
+        }
+        pawnBitboardToMoves(pawnSquare, targets, NO_EN_PASSANT, captures);
+        if (push) {
+            captures.push_back(encodeMove(pawnSquare, __builtin_ctzll(push), PROMOTION_QUEEN));
+        }
+    }
+
+    // King captures, filtered from its moves
+    int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+    if (king_threats_table[kingSquare] & enemyOccupancy) {
+        MoveList kingMoves;
+        generateKingMoves(board, kingMoves);
+        for (uint16_t move : kingMoves) {
+            int fromSquare, toSquare, special;
+            decodeMove(move, fromSquare, toSquare, special);
+            if (enemyOccupancy & (1ULL << toSquare)) captures.push_back(move);
+        }
+    }
+
+    generateEnPassantMoves(board, captures);
+    return captures;
+}
+
+/**
+ * Determines whether a square is attacked by one side.
+ *
+ * @param board The current board state.
+ * @param square The square to examine.
+ * @param occupancy The occupancy sliders are blocked by.
+ * @param byWhite The attacking side.
+ * @return True if any piece of that side attacks the square.
+ */
+bool isSquareAttacked(const BoardState& board, int square, uint64_t occupancy, bool byWhite) {
+    uint64_t queens = board.getBitboard(byWhite ? WHITE_QUEENS : BLACK_QUEENS);
+    // An attacking pawn stands where a defending pawn on the square would attack
+    uint64_t pawnAttacks = byWhite ? bpawn_threats_table[square] : wpawn_threats_table[square];
+    return (pawnAttacks & board.getBitboard(byWhite ? WHITE_PAWNS : BLACK_PAWNS)) ||
+           (knight_threats_table[square] &
+            board.getBitboard(byWhite ? WHITE_KNIGHTS : BLACK_KNIGHTS)) ||
+           (king_threats_table[square] & board.getBitboard(byWhite ? WHITE_KINGS : BLACK_KINGS)) ||
+           (Bmagic(square, occupancy) &
+            (board.getBitboard(byWhite ? WHITE_BISHOPS : BLACK_BISHOPS) | queens)) ||
+           (Rmagic(square, occupancy) &
+            (board.getBitboard(byWhite ? WHITE_ROOKS : BLACK_ROOKS) | queens));
+}
+
+/**
+ * Determines whether a move could be played in this position, ignoring checks and pins.
+ *
+ * - Meant for moves that come from somewhere other than the generator, such as the
+ *   transposition table, where a key collision can hand back any 16-bit value.
+ * - The moving piece must belong to the side to move, and the special bits must match
+ *   what the generator would have produced for that piece and those squares.
+ * - Castling needs the right, the king and an empty path; whether the king passes
+ *   through check is left to `isLegal`.
+ *
+ * @param board The current board state.
+ * @param move Any 16-bit value.
+ * @return True if the move is pseudo-legal.
+ */
+bool isPseudoLegal(const BoardState& board, uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    bool isWhite = board.getTurn();
+    uint64_t toMask = 1ULL << toSquare;
+    uint64_t allOccupancy = board.getAllOccupancy();
+
+    int pieceType = board.pieceOn(fromSquare);
+    if (pieceType == NO_PIECE || (pieceType < BLACK_PAWNS) != isWhite) return false;
+    if (board.getOccupancy(isWhite) & toMask) return false;
+
+    if (pieceType % 6 != WHITE_PAWNS) {
+        if (special == CASTLING_KINGSIDE || special == CASTLING_QUEENSIDE) {
+            int kingSquare = isWhite ? 4 : 60;
+            bool kingside = special == CASTLING_KINGSIDE;
+            // Squares between the king and the rook: f and g, or b, c and d
+            uint64_t path = kingside ? (0x60ULL << (kingSquare - 4))
+                                     : (0x0EULL << (kingSquare - 4));
+            return pieceType % 6 == WHITE_KINGS && fromSquare == kingSquare &&
+                   toSquare == (kingside ? kingSquare + 2 : kingSquare - 2) &&
+                   (kingside ? board.canCastleKingside(isWhite)
+                             : board.canCastleQueenside(isWhite)) &&
+                   !(path & allOccupancy);
+        }
+        return special == SPECIAL_NONE &&
+               (generateThreatMask(pieceType, fromSquare, allOccupancy) & toMask);
+    }
+
+    // Pawns
+    int forward = isWhite ? 8 : -8;
+    bool lastRank = toSquare >= 56 || toSquare <= 7;
+    bool isPromotion = special >= PROMOTION_QUEEN && special <= PROMOTION_BISHOP;
+    uint64_t attacks = (isWhite ? wpawn_threats_table : bpawn_threats_table)[fromSquare];
+    if (special == EN_PASSANT) {
+        return toSquare == board.getEnPassant() && (attacks & toMask);
+    }
+    if (special == DOUBLE_PAWN_PUSH) {
+        int startRankFirst = isWhite ? 8 : 48;
+        return fromSquare >= startRankFirst && fromSquare < startRankFirst + 8 &&
+               toSquare == fromSquare + 2 * forward &&
+               !(allOccupancy & ((1ULL << (fromSquare + forward)) | toMask));
+    }
+    if (special != SPECIAL_NONE && !isPromotion) return false;
+    if (isPromotion != lastRank) return false;
+    bool isPush = toSquare == fromSquare + forward && !(allOccupancy & toMask);
+    bool isCapture = (attacks & toMask & board.getOccupancy(!isWhite)) != 0;
+    return isPush || isCapture;
+}
+
+/**
+ * Determines whether a pseudo-legal move leaves the own king safe.
+ *
+ * - King moves: the destination must not be attacked once the king has left its square.
+ * - Castling: not out of, through or into check.
+ * - En passant: checked on the board after the capture, like the generator does.
+ * - Other moves: in check they must capture the only checker or block it, and a pinned
+ *   piece must stay on the line through its king.
+ *
+ * @param board The current board state.
+ * @param move A move for which `isPseudoLegal` holds.
+ * @return True if the move is legal.
+ */
+bool isLegal(const BoardState& board, uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    bool isWhite = board.getTurn();
+    const StateInfo& state = board.stateInfo();
+    uint64_t fromMask = 1ULL << fromSquare;
+    uint64_t toMask = 1ULL << toSquare;
+    uint64_t allOccupancy = board.getAllOccupancy();
+
+    if (special == EN_PASSANT) {
+        return isLegalEnPassant(board, fromSquare, toSquare);
+    }
+    if (special == CASTLING_KINGSIDE || special == CASTLING_QUEENSIDE) {
+        int step = special == CASTLING_KINGSIDE ? 1 : -1;
+        return !state.checkers &&
+               !isSquareAttacked(board, fromSquare + step, allOccupancy, !isWhite) &&
+               !isSquareAttacked(board, toSquare, allOccupancy, !isWhite);
+    }
+    if (board.pieceOn(fromSquare) % 6 == WHITE_KINGS) {
+        return !isSquareAttacked(board, toSquare, allOccupancy ^ fromMask, !isWhite);
+    }
+
+    int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+    if (state.checkers) {
+        if (state.checkers & (state.checkers - 1)) return false;  // Only the king can move
+        int checkerSquare = __builtin_ctzll(state.checkers);
+        if (!(toMask & (between_table[kingSquare][checkerSquare] | state.checkers))) {
+            return false;
+        }
+    }
+    if (state.blockers[isWhite ? 0 : 1] & fromMask) {
+        return (between_table[kingSquare][fromSquare] & toMask) ||
+               (between_table[kingSquare][toSquare] & fromMask);
+    }
+    return true;
+}
@@ -0,0 +1,318 @@
+#include "movepick.hpp"
+
+/**
+ * Determines whether the picker treats a move as a capture.
+ *
+ * - Captures, en passant and queen promotions; everything else, underpromotions
+ *   included, is quiet.
+ *
+ * @param board The current board state.
+ * @param move A legal move in this position.
+ * @return True for captures and queen promotions.
+ */
+bool isNoisy(const BoardState& board, uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    return board.pieceOn(toSquare) != NO_PIECE || special == EN_PASSANT ||
+           special == PROMOTION_QUEEN;
+}
+
+/**
+ * Scores a quiet move without any history.
+ *
+ * - Checks, castling and knight promotions are tried early; rook and bishop promotions,
+ *   and pawn and king moves, later.
+ *
+ * @param board The current board state.
+ * @param move The quiet move to score.
+ * @return The ordering score, higher is better.
+ */
+static int staticQuietScore(const BoardState& board, uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    int pieceType = board.pieceOn(fromSquare) % 6;
+
+    int score = 0;
+    if (givesCheck(board, move)) score += 5;
+    if (special == PROMOTION_KNIGHT) score += 2;
+    else if (special == PROMOTION_ROOK) score -= 4;
+    else if (special == PROMOTION_BISHOP) score -= 3;
+    else if (special == CASTLING_KINGSIDE || special == CASTLING_QUEENSIDE) score += 4;
+
+    if (pieceType == WHITE_PAWNS || pieceType == WHITE_KINGS) score -= 1;
+    return score;
+}
+
+/**
+ * Finds the best scored move in [begin, end) and swaps it to `begin`.
+ *
+ * - Selection instead of a full sort: a node that cuts off after a few moves only pays for
+ *   a few passes over the list.
+ *
+ * @param moves The move list.
+ * @param begin The first index still to be handed out.
+ * @param end One past the last index of the range.
+ * @return The best move of the range, now at `begin`.
+ */
+static uint16_t pickBest(MoveList& moves, size_t begin, size_t end) {
+    size_t best = begin;
+    int bestScore = moves[begin].score;
+    for (size_t i = begin + 1; i < end; ++i) {
+        if (moves[i].score > bestScore) {
+            best = i;
+            bestScore = moves[i].score;
+        }
+    }
+    std::swap(moves[begin], moves[best]);
+    return moves[begin].move;
+}
+
+/**
+ * Constructor for a move picker without search history.
+ *
+ * - Quiets are ordered by a static score and there are no refutations to try.
+ *
+ * @param board The current board state; it must not change while moves are picked.
+ * @param ttMove The move stored in the transposition table, legal here, or 0.
+ */
+MovePicker::MovePicker(const BoardState& board, uint16_t ttMove)
+    : board(board), history(nullptr), continuation{}, ttMove(ttMove), refutations{} {
+    stage = ttMove ? STAGE_TT_MOVE : STAGE_GENERATE;
+}
+
+/**
+ * Constructor for a move picker inside the search.
+ *
+ * - Starts at the TT move stage when there is one, and at generation otherwise.
+ * - Refutations equal to the TT move or to an earlier refutation are dropped.
+ *
+ * @param board The current board state; it must not change while moves are picked.
+ * @param ttMove The move stored in the transposition table, legal here, or 0.
+ * @param history The history tables of the searching thread.
+ * @param killers The killer moves of this ply.
+ * @param counterMove The counter move to the previous move, or 0.
+ * @param continuation The continuation history rows of the moves 1 and 2 plies back.
+ */
+MovePicker::MovePicker(const BoardState& board, uint16_t ttMove, const HistoryTables& history,
+                       const uint16_t killers[KILLER_SLOTS], uint16_t counterMove,
+                       const PieceToHistory* const continuation[CONTINUATION_PLIES])
+    : board(board), history(&history), ttMove(ttMove) {
+    stage = ttMove ? STAGE_TT_MOVE : STAGE_GENERATE;
+    for (int i = 0; i < CONTINUATION_PLIES; ++i) {
+        this->continuation[i] = continuation[i];
+    }
+    uint16_t candidates[REFUTATION_SLOTS] = {killers[0], killers[1], counterMove};
+    for (int i = 0; i < REFUTATION_SLOTS; ++i) {
+        refutations[i] = candidates[i];
+        for (int j = 0; j < i; ++j) {
+            if (candidates[i] == candidates[j]) refutations[i] = 0;
+        }
+        if (candidates[i] == ttMove) refutations[i] = 0;
+    }
+}
+
+/**
+ * Constructor for a move picker inside quiescence search.
+ *
+ * - Out of check, only captures and promotions are generated, and captures that lose
+ *   material are dropped rather than tried last. A TT move that is quiet is dropped too.
+ * - In check, every evasion is handed out as in the main search, without refutations.
+ *
+ * @param board The current board state; it must not change while moves are picked.
+ * @param ttMove The move stored in the transposition table, legal here, or 0.
+ * @param history The history tables of the searching thread.
+ * @param checks Whether to hand out quiet checks after the captures.
+ */
+MovePicker::MovePicker(const BoardState& board, uint16_t ttMove, const HistoryTables& history,
+                       bool checks)
+    : board(board), history(&history), continuation{}, ttMove(ttMove), refutations{} {
+    captureOnly = !board.getCheckers();
+    quietChecks = captureOnly && checks;
+    if (captureOnly && ttMove && !isNoisy(board, ttMove)) this->ttMove = 0;
+    stage = this->ttMove ? STAGE_TT_MOVE : STAGE_GENERATE;
+}
+
+/**
+ * Generates the legal moves and splits them into captures and quiets.
+ *
+ * - Captures, en passant and queen promotions are moved to the front and given their
+ *   MVV-LVA score; the quiets behind them are only scored once they are reached.
+ * - Refutations that are not quiet legal moves here are dropped.
+ */
+void MovePicker::generate() {
+    moves = captureOnly ? allLegalCaptures(board) : allLegalMoves(board);
+    for (size_t i = 0; i < moves.size(); ++i) {
+        if (isNoisy(board, moves[i].move)) {
+            moves[i].score = captureScore(moves[i].move);
+            std::swap(moves[i], moves[captureEnd++]);
+        }
+    }
+
+    for (uint16_t& refutation : refutations) {
+        bool found = false;
+        for (size_t i = captureEnd; i < moves.size() && !found; ++i) {
+            found = moves[i].move == refutation;
+        }
+        if (!found) refutation = 0;
+    }
+}
+
+/**
+ * Orders captures by the most valuable victim, then the least valuable attacker.
+ *
+ * - Queen promotions count as winning a queen less the pawn, on top of anything captured.
+ * - Capture history adjusts the order within about a pawn of victim value.
+ *
+ * @param move The capture or promotion to score.
+ * @return The ordering score, higher is better.
+ */
+int MovePicker::captureScore(uint16_t move) const {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    int attacker = board.pieceOn(fromSquare);
+    int victim = special == EN_PASSANT ? WHITE_PAWNS : board.pieceOn(toSquare);
+
+    int score = victim == NO_PIECE ? 0 : std::abs(MATERIAL_SCORES[victim]) * 8;
+    if (special == PROMOTION_QUEEN) {
+        score += (std::abs(MATERIAL_SCORES[WHITE_QUEENS]) - std::abs(MATERIAL_SCORES[WHITE_PAWNS])) * 8;
+    }
+    if (history && victim != NO_PIECE) {
+        score += history->captures[attacker][toSquare][victim % 6] / 16;
+    }
+    return score - attacker % 6;
+}
+
+/**
+ * Scores a quiet move by the history of the searching thread.
+ *
+ * - Butterfly history of the move, plus the continuation history of the moved piece and
+ *   destination after each of the last two moves.
+ * - Falls back to a static score when there is no history.
+ *
+ * @param move The quiet move to score.
+ * @return The ordering score, higher is better.
+ */
+int MovePicker::quietScore(uint16_t move) const {
+    if (!history) return staticQuietScore(board, move);
+
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    int pieceType = board.pieceOn(fromSquare);
+    int score = history->butterfly[board.getTurn() ? 0 : 1][fromSquare][toSquare];
+    for (const PieceToHistory* table : continuation) {
+        if (table) score += (*table)[pieceType][toSquare];
+    }
+    return score;
+}
+
+/**
+ * Tells whether a move was already handed out by an earlier stage.
+ *
+ * @param move The move to test.
+ * @return True for the TT move and the refutations that were played.
+ */
+bool MovePicker::isSkipped(uint16_t move) const {
+    if (move == ttMove) return true;
+    for (uint16_t refutation : refutations) {
+        if (move == refutation) return true;
+    }
+    return false;
+}
+
+/**
+ * Hands out the next move.
+ *
+ * - TT move, good captures by MVV-LVA, killers and the counter move, quiets by history,
+ *   then bad captures. In quiescence search, the good captures and possibly quiet checks.
+ * - SEE is only computed for a capture once it is picked, and only when the victim is
+ *   worth less than the attacker. Captures that lose material wait until the end.
+ *
+ * @return The next legal move, or 0 when there are none left.
+ */
+uint16_t MovePicker::nextMove() {
+    switch (stage) {
+        case STAGE_TT_MOVE:
+            stage = STAGE_GENERATE;
+            return ttMove;
+
+        case STAGE_GENERATE:
+            generate();
+            stage = STAGE_GOOD_CAPTURES;
+            [[fallthrough]];
+
+        case STAGE_GOOD_CAPTURES:
+            while (current < captureEnd) {
+                uint16_t move = pickBest(moves, current, captureEnd);
+                ++current;
+                if (move == ttMove) continue;
+
+                int fromSquare, toSquare, special;
+                decodeMove(move, fromSquare, toSquare, special);
+                int attacker = board.pieceOn(fromSquare);
+                int victim = board.pieceOn(toSquare);
+                if (special == SPECIAL_NONE && victim != NO_PIECE &&
+                    std::abs(MATERIAL_SCORES[victim]) < std::abs(MATERIAL_SCORES[attacker]) &&
+                    see(board, toSquare, victim, fromSquare, attacker) < 0) {
+                    if (!captureOnly) moves[badCaptureEnd++] = moves[current - 1];
+                    continue;
+                }
+                return move;
+            }
+            if (captureOnly) {
+                stage = quietChecks ? STAGE_GENERATE_CHECKS : STAGE_DONE;
+                return nextMove();
+            }
+            stage = STAGE_REFUTATIONS;
+            [[fallthrough]];
+
+        case STAGE_REFUTATIONS:
+            while (refutationIndex < REFUTATION_SLOTS) {
+                uint16_t refutation = refutations[refutationIndex++];
+                if (refutation) return refutation;
+            }
+            stage = STAGE_SCORE_QUIETS;
+            [[fallthrough]];
+
+        case STAGE_SCORE_QUIETS:
+            for (size_t i = captureEnd; i < moves.size(); ++i) {
+                moves[i].score = quietScore(moves[i].move);
+            }
+            current = captureEnd;
+            stage = STAGE_QUIETS;
+            [[fallthrough]];
+
+        case STAGE_QUIETS:
+            while (current < moves.size()) {
+                uint16_t move = pickBest(moves, current, moves.size());
+                ++current;
+                if (!isSkipped(move)) return move;
+            }
+            current = 0;
+            stage = STAGE_BAD_CAPTURES;
+            [[fallthrough]];
+
+        case STAGE_BAD_CAPTURES:
+            if (current < badCaptureEnd) {
+                return moves[current++].move;
+            }
+            stage = STAGE_DONE;
+            return 0;
+
+        case STAGE_GENERATE_CHECKS:
+            moves = allLegalMoves(board);
+            current = 0;
+            stage = STAGE_QUIET_CHECKS;
+            [[fallthrough]];
+
+        case STAGE_QUIET_CHECKS:
+            while (current < moves.size()) {
+                uint16_t move = moves[current++].move;
+                if (!isNoisy(board, move) && givesCheck(board, move)) return move;
+            }
+            stage = STAGE_DONE;
+            [[fallthrough]];
+
+        default:
+            return 0;
+    }
+}
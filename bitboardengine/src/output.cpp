@@ -0,0 +1,74 @@
+#include "output.hpp"
+
+OutputWriter uciOutput(std::cout);
+
+/**
+ * @param outParam The stream the buffered lines are written to.
+ */
+OutputWriter::OutputWriter(std::ostream& outParam)
+    : out(outParam), lastFlush(std::chrono::steady_clock::now()), lastThrottled(lastFlush) {}
+
+/**
+ * Queues one line of output.
+ *
+ * - The line is written once the flush interval has passed since the last write, or
+ *   immediately (together with everything queued before it) when `flushNow` is set.
+ *
+ * @param line The line, without the trailing newline.
+ * @param flushNow Whether the GUI is waiting for this line.
+ */
+void OutputWriter::write(const std::string& line, bool flushNow) {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer += line;
+    buffer += '\n';
+    if (flushNow || std::chrono::steady_clock::now() - lastFlush >=
+                        std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS)) {
+        flushLocked();
+    }
+}
+
+/**
+ * Queues a line that may be skipped, such as a currmove update.
+ *
+ * - The line is dropped if the previous throttled line is less than one flush interval old.
+ *
+ * @param line The line, without the trailing newline.
+ */
+void OutputWriter::writeThrottled(const std::string& line) {
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (now - lastThrottled < std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS)) return;
+        lastThrottled = now;
+    }
+    write(line);
+}
+
+/**
+ * Writes the queued lines if they have waited a full flush interval. Polled by the
+ * search so buffered lines go out even when nothing new is written.
+ */
+void OutputWriter::flushIfDue() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!buffer.empty() && std::chrono::steady_clock::now() - lastFlush >=
+                               std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS)) {
+        flushLocked();
+    }
+}
+
+/**
+ * Writes the queued lines now.
+ */
+void OutputWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushLocked();
+}
+
+// Writes the buffer to the stream; the caller holds the mutex
+void OutputWriter::flushLocked() {
+    if (!buffer.empty()) {
+        out << buffer << std::flush;
+        buffer.clear();
+    }
+    lastFlush = std::chrono::steady_clock::now();
+}
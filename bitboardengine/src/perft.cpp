@@ -0,0 +1,252 @@
+#include "perft.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+/**
+ * Allocates the largest power-of-two number of slots that fits in `sizeMB`.
+ *
+ * @param sizeMB The table size in megabytes; 0 disables the table.
+ */
+PerftTable::PerftTable(int sizeMB) : slotCount(0) {
+    if (sizeMB <= 0) return;
+    size_t maxSlots = (size_t(sizeMB) << 20) / sizeof(Slot);
+    slotCount = 1;
+    while (slotCount * 2 <= maxSlots) slotCount *= 2;
+    slots.reset(new Slot[slotCount]);
+    for (size_t i = 0; i < slotCount; ++i) {
+        slots[i].keyXorData.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Looks up the leaf count of a subtree.
+ *
+ * @param hash The Zobrist hash of the subtree's root.
+ * @param depth The remaining depth.
+ * @param count Set to the stored count on a hit.
+ * @return True on a hit.
+ */
+bool PerftTable::probe(uint64_t hash, int depth, uint64_t& count) const {
+    const Slot& slot = slots[hash & (slotCount - 1)];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t keyXorData = slot.keyXorData.load(std::memory_order_relaxed);
+    if ((keyXorData ^ data) != hash || int(data & 0xFF) != depth) return false;
+    count = data >> 8;
+    return true;
+}
+
+/**
+ * Stores the leaf count of a subtree, always replacing the slot.
+ *
+ * @param hash The Zobrist hash of the subtree's root.
+ * @param depth The remaining depth.
+ * @param count The number of leaves.
+ */
+void PerftTable::store(uint64_t hash, int depth, uint64_t count) {
+    Slot& slot = slots[hash & (slotCount - 1)];
+    uint64_t data = (count << 8) | uint64_t(depth);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.keyXorData.store(hash ^ data, std::memory_order_relaxed);
+}
+
+/**
+ * Counts the leaf nodes of the legal move tree to a fixed depth.
+ *
+ * - Bulk counting: at depth 1 the number of legal moves is the answer, so the last ply
+ *   is never made and unmade.
+ * - With a table, subtrees already counted (transpositions) are looked up instead.
+ *
+ * @param board The position; restored before returning.
+ * @param depth The depth to count to.
+ * @param table An optional perft hash table.
+ * @return The number of leaf nodes.
+ */
+uint64_t perft(BoardState& board, int depth, PerftTable* table) {
+    MoveList moves = allLegalMoves(board);
+    if (depth <= 1) {
+        return depth == 1 ? moves.size() : 1;
+    }
+
+    uint64_t hash = board.getZobristHash();
+    uint64_t nodes = 0;
+    if (table && table->probe(hash, depth, nodes)) {
+        return nodes;
+    }
+
+    for (uint16_t move : moves) {
+        MoveUndo undoData = applyMove(board, move);
+        nodes += perft(board, depth - 1, table);
+        undoMove(board, undoData);
+    }
+
+    if (table) table->store(hash, depth, nodes);
+    return nodes;
+}
+
+/**
+ * Runs perft with the root moves split over several threads.
+ *
+ * - Each thread takes the next unclaimed root move and counts its subtree on its own
+ *   copy of the board. The optional hash table is shared.
+ *
+ * @param board The root position.
+ * @param depth The depth to count to.
+ * @param threads The number of threads.
+ * @param hashMB The perft hash size in megabytes, 0 for none.
+ * @param print Whether to print the count of every root move (divide).
+ * @return The number of leaf nodes.
+ */
+uint64_t perftDivide(const BoardState& board, int depth, int threads, int hashMB, bool print) {
+    MoveList rootMoves = allLegalMoves(board);
+    if (depth <= 1) {
+        if (print) {
+            for (uint16_t move : rootMoves) std::cout << moveToString(move) << ": 1\n";
+        }
+        return depth == 1 ? rootMoves.size() : 1;
+    }
+
+    PerftTable table(hashMB);
+    std::vector<uint64_t> counts(rootMoves.size(), 0);
+    std::atomic<size_t> nextMove(0);
+
+    auto worker = [&]() {
+        BoardState threadBoard = board;
+        size_t i;
+        while ((i = nextMove.fetch_add(1)) < rootMoves.size()) {
+            MoveUndo undoData = applyMove(threadBoard, rootMoves[i]);
+            counts[i] = perft(threadBoard, depth - 1, table.enabled() ? &table : nullptr);
+            undoMove(threadBoard, undoData);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (std::thread& thread : workers) thread.join();
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < rootMoves.size(); ++i) {
+        if (print) std::cout << moveToString(rootMoves[i]) << ": " << counts[i] << "\n";
+        total += counts[i];
+    }
+    return total;
+}
+
+/**
+ * The `perft` and `divide` commands: counts the leaves of the current position and
+ * reports the speed in leaf nodes per second.
+ *
+ * @param depth The depth to count to.
+ * @param threads The number of threads.
+ * @param hashMB The perft hash size in megabytes, 0 for none.
+ * @param divide Whether to print the count of every root move.
+ * @param board The position to count from.
+ */
+void runPerft(int depth, int threads, int hashMB, bool divide, const BoardState& board) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = perftDivide(board, depth, threads, hashMB, divide);
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (divide) std::cout << "\n";
+    std::cout << "Nodes: " << nodes << "\n";
+    std::cout << "Time (ms): " << uint64_t(seconds * 1000) << "\n";
+    std::cout << "Mnodes/s: " << std::fixed << std::setprecision(2)
+              << nodes / std::max(seconds, 1e-9) / 1e6 << std::endl;
+}
+
+/**
+ * Checks `givesCheck` against making each move and testing the enemy king, for every
+ * move of the tree to a fixed depth.
+ *
+ * @param board The position; restored before returning.
+ * @param depth The depth to check to.
+ * @return The number of moves where `givesCheck` was wrong.
+ */
+static uint64_t givesCheckMismatches(BoardState& board, int depth) {
+    uint64_t mismatches = 0;
+    for (uint16_t move : allLegalMoves(board)) {
+        bool predicted = givesCheck(board, move);
+        MoveUndo undoData = applyMove(board, move);
+        bool isWhite = board.getTurn();
+        int kingSquare = __builtin_ctzll(board.getBitboard(isWhite ? WHITE_KINGS : BLACK_KINGS));
+        if (predicted != isSquareAttacked(board, kingSquare, board.getAllOccupancy(), !isWhite)) {
+            mismatches++;
+        }
+        if (depth > 1) mismatches += givesCheckMismatches(board, depth - 1);
+        undoMove(board, undoData);
+    }
+    return mismatches;
+}
+
+// A position of the perft suite and its known leaf counts from depth 1 on
+struct PerftSuiteEntry {
+    const char* name;
+    const char* fen;
+    std::vector<uint64_t> counts;
+};
+
+/**
+ * Runs the standard perft suite and checks every count against the known values.
+ *
+ * - Start position, Kiwipete and positions 3 to 6 of the chessprogramming wiki, and
+ *   one with both kings on their back rank.
+ * - Prints one line per position and depth with the result and speed, and a summary.
+ * - Also checks `givesCheck` on every move of each position's tree to PERFT_CHECK_DEPTH.
+ *
+ * @param threads The number of threads.
+ * @param hashMB The perft hash size in megabytes, 0 for none.
+ */
+void runPerftSuite(int threads, int hashMB) {
+    const PerftSuiteEntry suite[] = {
+        {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+         {20, 400, 8902, 197281, 4865609}},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+         {48, 2039, 97862, 4085603}},
+        {"position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+         {14, 191, 2812, 43238, 674624}},
+        {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+         {6, 264, 9467, 422333}},
+        {"position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+         {44, 1486, 62379, 2103487}},
+        {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+         {46, 2079, 89890, 3894594}},
+        // Kings on the back ranks in front of promoting pawns, for the givesCheck check
+        {"backrank", "3K4/4P3/8/8/8/8/4p3/3k4 w - - 0 1", {8, 64, 702, 7075}},
+    };
+
+    int passed = 0, failed = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const PerftSuiteEntry& entry : suite) {
+        BoardState board = parseFEN(entry.fen);
+        for (size_t depth = 1; depth <= entry.counts.size(); ++depth) {
+            uint64_t nodes = perftDivide(board, int(depth), threads, hashMB, false);
+            bool ok = nodes == entry.counts[depth - 1];
+            ok ? passed++ : failed++;
+            totalNodes += nodes;
+            std::cout << std::setw(10) << entry.name << "  depth " << depth << std::setw(12)
+                      << nodes << "  " << (ok ? "ok" : "FAIL, expected " +
+                                                           std::to_string(entry.counts[depth - 1]))
+                      << std::endl;
+        }
+
+        int checkDepth = std::min(int(entry.counts.size()), PERFT_CHECK_DEPTH);
+        uint64_t mismatches = givesCheckMismatches(board, checkDepth);
+        mismatches == 0 ? passed++ : failed++;
+        std::cout << std::setw(10) << entry.name << "  givesCheck to depth " << checkDepth << "  "
+                  << (mismatches == 0 ? "ok" : "FAIL, " + std::to_string(mismatches) + " wrong")
+                  << std::endl;
+    }
+
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::string(40, '-') << std::endl;
+    std::cout << passed << " passed, " << failed << " failed" << std::endl;
+    std::cout << "Mnodes/s: " << std::fixed << std::setprecision(2)
+              << totalNodes / std::max(seconds, 1e-9) / 1e6 << std::endl;
+}
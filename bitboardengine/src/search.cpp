@@ -1,11 +1,13 @@
-#include "search.hpp"
+#include "threads.hpp"
+#include <cmath>
+
 // Assumed to be white's turn, but they can't move, so black wins
-bool blackCheckmate(const BoardState& board, const std::vector<uint16_t>& legalMoves) {
+bool blackCheckmate(const BoardState& board, const MoveList& legalMoves) {
     return legalMoves.empty() && is_in_check(board);  // False -> Black
 }
 
 // Assumed to be black's turn, but they can't move, so white wins
-bool whiteCheckmate(const BoardState& board, const std::vector<uint16_t>& legalMoves) {
+bool whiteCheckmate(const BoardState& board, const MoveList& legalMoves) {
     return legalMoves.empty() && is_in_check(board);  // True -> White
 }
 
@@ -87,39 +89,21 @@ bool fiftyMoveRule(const BoardState& board) {
  * @param legalMoves A list of legal moves for the current position.
  * @return True if the position is a stalemate, false otherwise.
  */
-bool stalemate(const BoardState& board, const std::vector<uint16_t>& legalMoves) {
+bool stalemate(const BoardState& board, const MoveList& legalMoves) {
     return legalMoves.empty() && !is_in_check(board);
 }
 
-/**
- * Determines if the current position has occurred three times, leading to a draw by threefold
- * repetition. This function checks the transposition table for the number of times the current
- * position's Zobrist hash has been encountered.
- *
- * @param table The transposition table storing previous positions.
- * @param current_pos_hash The Zobrist hash of the current position.
- * @return True if the position has occurred at least three times, false otherwise.
- */
-bool threefold(const TranspositionTable& table, uint64_t current_pos_hash) {
-    auto it = table.find(current_pos_hash);
-    if (it != table.end()) {
-        // If the hash exists in the table, check its visitCount
-        return it->second.visitCount >= 3;
-    }
-    return false;  // If the hash is not found, it's not a repetition
-}
-
 /**
  * Determines the game result based on the current board state.
- * This function checks for checkmate, stalemate, the fifty-move rule,
- * insufficient material, and threefold repetition using the transposition table.
+ * This function checks for checkmate, stalemate, the fifty-move rule and
+ * insufficient material. Repetitions depend on the path to the position and are
+ * detected by `Search::isRepetition` instead.
  *
  * @param board The current board state.
  * @param legalMoves A list of legal moves available in the current position.
- * @param table The transposition table, used for threefold repetition checks.
  * @return The game result: WHITE_WINS, BLACK_WINS, DRAW (various types), or ONGOING.
  */
-GameResult gameOver(const BoardState& board, const std::vector<uint16_t>& legalMoves, TranspositionTable& table) {
+GameResult gameOver(const BoardState& board, const MoveList& legalMoves) {
     if(board.getTurn()){ //White's turn and no legal moves
         if (blackCheckmate(board, legalMoves)) return WHITE_WINS;
     }
@@ -129,7 +113,6 @@ GameResult gameOver(const BoardState& board, const std::vector<uint16_t>& legalM
     if (stalemate(board, legalMoves)) return DRAW_STALEMATE;
     if (fiftyMoveRule(board)) return DRAW_50_MOVE_RULE;
     if (insufficientMaterial(board)) return DRAW_INSUFFICIENT_MATERIAL;
-    if (threefold(table, board.getZobristHash())) return DRAW_THREEFOLD_REPETITION;
     return ONGOING;
 }
 
@@ -159,14 +142,14 @@ int see(const BoardState& board, int toSq, int target, int frSq, int aPiece);
  * - Checks, castling, and promotions are given priority.
  * - Pawns and kings are slightly deprioritized to encourage deeper searches first.
  *
+ * - The scores are kept in the list's score slots and the list is sorted in place.
+ *
  * @param board The current board state.
- * @param moves A vector of legal moves.
- * @return A vector of moves ordered from highest to lowest priority.
+ * @param moves The legal moves, reordered from highest to lowest priority.
  */
-std::vector<uint16_t> orderMoves(BoardState& board, const std::vector<uint16_t>& moves) {
-    std::vector<std::pair<int, uint16_t>> scoredMoves;
-
-    for (const auto& move : moves) {
+void orderMoves(BoardState& board, MoveList& moves) {
+    for (ScoredMove& scoredMove : moves) {
+        uint16_t move = scoredMove.move;
         int score = 0;
         int fromSquare, toSquare, special;
         decodeMove(move, fromSquare, toSquare, special);
@@ -175,11 +158,8 @@ std::vector<uint16_t> orderMoves(BoardState& board, const std::vector<uint16_t>&
         uint64_t toSquareMask = (1ULL << toSquare);
         
         int fromPieceType = findPieceType(board, fromSquareMask, board.getTurn());
-        uint64_t threatMask = generateThreatMask(fromPieceType, toSquare, board.getAllOccupancy());
-        int enemyKingIndex = board.getTurn() ? BLACK_KINGS : WHITE_KINGS;
 
-        
-        bool isCheck = threatMask & board.getBitboard(enemyKingIndex);
+        bool isCheck = givesCheck(board, move);
         bool isCapture = toSquareMask & board.getOccupancy(!board.getTurn());
         
         // Compare the value of the capturing piece with the captured piece
@@ -199,19 +179,11 @@ std::vector<uint16_t> orderMoves(BoardState& board, const std::vector<uint16_t>&
         if(fromPieceType == WHITE_PAWNS || fromPieceType == BLACK_PAWNS) score -= 1;
         else if(fromPieceType == WHITE_KINGS || fromPieceType == BLACK_KINGS) score -= 1;
 
-        scoredMoves.emplace_back(score, move);
+        scoredMove.score = score;
     }
 
     // Sort moves by descending score
-    std::sort(scoredMoves.begin(), scoredMoves.end(), std::greater<>());
-
-    // Extract sorted moves
-    std::vector<uint16_t> orderedMoves;
-    for (const auto& scoredMove : scoredMoves) {
-        orderedMoves.push_back(scoredMove.second);
-    }
-
-    return orderedMoves;
+    moves.sort();
 }
 
 /**
@@ -369,147 +341,636 @@ int see(const BoardState& board, int toSq, int target, int frSq, int aPiece) {
     return gain[0];
 }
 
+// Late move reductions by [depth][move number], filled in by initReductions
+static int reductionTable[MAX_SEARCH_PLY + 1][MAX_MOVES + 1];
+
 /**
- * @brief Filters a list of legal moves to include only favorable captures, promotions, and checks.
- *
- * This function refines a list of legal moves by selecting:
- * - Captures that result in a net material gain (using Static Exchange Evaluation).
- * - Queen promotions.
- * - Moves that deliver check.
+ * Precomputes the late move reductions, once at startup.
  *
- * This is used in Quiescence Search to extend search depth on unstable positions.
- *
- * @param board The current board state.
- * @param moves A list of all legal moves.
- * @return A filtered list of favorable captures, promotions, and checks.
- */
-std::vector<uint16_t> goodCaptureOrChecks(BoardState& board, const std::vector<uint16_t>& moves) {
-    std::vector<uint16_t> result;
-    for (uint16_t move : moves) {
-        // Check if the position is in check after the move
-        MoveUndo undoState = applyMove(board, move);
-        bool check = is_in_check(board);
-        undoMove(board, undoState);
-        if (check) {
-            result.push_back(move);
-            continue;
-        }
-
-        int toSq, frSq, special;
-        decodeMove(move, frSq, toSq, special);
-        if (special == PROMOTION_QUEEN) {
-            result.push_back(move);
-            continue;
-        }
-
-        //If the tosquare is occupied by a piece already, it's a capture.
-        if ((1ULL << toSq) & board.getAllOccupancy()) {
-            // Use SEE to evaluate the capture
-            int movingPiece = findPieceType(board, (1ULL << frSq), board.getTurn());
-            int capturedPiece = findPieceType(board, (1ULL << toSq), !board.getTurn());
-
-            if (see(board, toSq, capturedPiece, frSq, movingPiece) > 0) {
-                result.push_back(move);
-            }
+ * - The reduction grows with the logarithm of both the depth and the move number, so late
+ *   moves in deep searches lose the most; the search adjusts it for each move.
+ */
+void initReductions() {
+    for (int depth = 1; depth <= MAX_SEARCH_PLY; ++depth) {
+        for (int move = 1; move <= MAX_MOVES; ++move) {
+            reductionTable[depth][move] =
+                int(LMR_BASE + std::log(double(depth)) * std::log(double(move)) / LMR_DIVISOR);
         }
     }
-
-    return result;
 }
 
 /**
  * @brief Constructor for the Search class.
  *
- * Initializes the search parameters, including the board state, transposition table,
- * time limit, and search control variables.
+ * Initializes the search parameters, including the board state, limits, and search
+ * control variables. The transposition table is borrowed from the engine context, not copied,
+ * so every thread of a parallel search shares it.
  *
  * @param boardParam The board state to search on.
- * @param tableParam The transposition table used for storing results.
- * @param timeLimitParam The time limit in milliseconds for the search.
- */
-Search::Search(BoardState& boardParam, TranspositionTable& tableParam, int timeLimitParam) {
-    board = boardParam;
-    table = tableParam;
-    timeLimitMs = timeLimitParam;
-    maxDepth = 12;
+ * @param context The engine context that owns the transposition table.
+ * @param limits The time and depth limits for the search.
+ * @param threadIdParam The index of the thread running this search (0 is the main thread).
+ * @param stopSignalParam Flag shared by all threads of a parallel search, or nullptr.
+ * @param printInfoParam Whether to send UCI info lines while searching.
+ * @param historyParam The history tables of the searching thread, or nullptr for fresh ones.
+ */
+Search::Search(const BoardState& boardParam, SearchContext& context, const SearchLimits& limits,
+               int threadIdParam, std::atomic<bool>* stopSignalParam, bool printInfoParam,
+               HistoryTables* historyParam)
+    : board(boardParam), table(context.table) {
+    // Game history first, then the root; search moves are pushed on top
+    keyStack.reserve(context.gameHistory.size() + 1 + MAX_SEARCH_PLY);
+    keyStack = context.gameHistory;
+    keyStack.push_back(board.getZobristHash());
+    rootIndex = int(keyStack.size()) - 1;
+
+    bool white = board.getTurn();
+    timeManager.init(white ? limits.wtime : limits.btime, white ? limits.winc : limits.binc,
+                     limits.movestogo, limits.movetime, context.moveOverheadMs);
+    maxDepth = limits.depth;
+    nodeLimit = limits.nodes;
+    mateLimit = limits.mate;
+    searchMoves = limits.searchMoves;
+    if (mateLimit > 0) {
+        maxDepth = std::min(maxDepth, 2 * mateLimit - 1);  // Deep enough to see a mate in N
+    }
+    threadId = threadIdParam;
+    stopSignal = stopSignalParam;
+    searchingMoves = (context.parallelMode == ABDADA && stopSignal && context.threads.size() > 1)
+                         ? &context.searchingMoves
+                         : nullptr;
+    ponderSignal = stopSignal ? &context.threads.ponder : nullptr;
+    pondering = limits.ponder && ponderSignal;
+    pool = stopSignal ? &context.threads : nullptr;
+    printInfo = printInfoParam;
+    pruning = context.pruning;
+    verifyingNullMove = false;
     bestMoveSoFar = 0;
-    bestEvalSoFar = -99999;
+    bestEvalSoFar = -999999;
+    completedDepth = 0;
     searchInterrupted = false;
+    bestMoveStability = 0;
+    timeCheckCountdown = TIME_CHECK_NODES;
+    selDepth = 0;
+    pvLength[0] = 0;
+
+    history = historyParam;
+    if (!history) {
+        ownHistory = std::make_unique<HistoryTables>();
+        ownHistory->clear();
+        history = ownHistory.get();
+    }
+    for (int ply = 0; ply <= MAX_SEARCH_PLY; ++ply) {
+        killers[ply][0] = killers[ply][1] = 0;
+        moveStack[ply] = 0;
+        pieceStack[ply] = NO_PIECE;
+        capturedStack[ply] = NO_PIECE;
+        excludedMoves[ply] = 0;
+        extensionStack[ply] = 0;
+    }
 }
 
 /**
  * @brief Checks whether the search should be stopped due to time constraints.
  *
- * This function monitors the elapsed search time and stops the search if the time limit
- * is exceeded. If the search is interrupted, the `searchInterrupted` flag is set.
+ * This function monitors the elapsed search time and stops the search once the hard
+ * time limit is exceeded. If the search is interrupted, the `searchInterrupted` flag is set.
+ * Only thread 0 reads the clock, and only every TIME_CHECK_NODES calls; when it runs out
+ * of time it raises the shared stop flag, which is all the helper threads look at. While
+ * pondering the clock is not running; on `ponderhit` the time budget starts from that moment.
+ * The same poll lets buffered info lines go out while an iteration is running.
+ * A node limit is checked on every call against the thread's own count, so a
+ * single-threaded node-limited search is exactly reproducible; with helper threads the
+ * total over all threads is checked at every clock poll.
  *
  * @return True if the search should stop, false otherwise.
  */
 bool Search::shouldStopSearch() {
-    auto now = std::chrono::steady_clock::now();
-    // std::cout << "now: " << now << std::endl;
-    // std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime)
-                    //  .count() << " >= " << timeLimitMs << std::endl;
-    if(std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count() >=
-        timeLimitMs){
-            searchInterrupted = true;
-            return true;
+    if (stopSignal && stopSignal->load(std::memory_order_relaxed)) {
+        searchInterrupted = true;
+        return true;
+    }
+    if (threadId != 0) {
+        return false;
+    }
+    if (nodeLimit && stats.nodes.load(std::memory_order_relaxed) >= nodeLimit) {
+        searchInterrupted = true;
+        if (stopSignal) stopSignal->store(true, std::memory_order_relaxed);
+        return true;
+    }
+    if (--timeCheckCountdown > 0) {
+        return false;
+    }
+    timeCheckCountdown = TIME_CHECK_NODES;
+
+    if (printInfo) uciOutput.flushIfDue();
+    if (nodeLimit && pool && pool->size() > 1 && pool->nodesSearched() >= nodeLimit) {
+        searchInterrupted = true;
+        stopSignal->store(true, std::memory_order_relaxed);
+        return true;
+    }
+    if (!timeManager.isLimited()) {
+        return false;
+    }
+
+    if (pondering) {
+        if (ponderSignal->load(std::memory_order_relaxed)) {
+            return false;
+        }
+        pondering = false;
+        timeManager.start();
+    }
+    if (timeManager.hardLimitReached()) {
+        searchInterrupted = true;
+        if (stopSignal) stopSignal->store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Plays a move on the search board and records the resulting position on the key stack.
+ *
+ * - The move and the piece it moves are kept by ply, for the history heuristics.
+ *
+ * @param move The move to apply.
+ * @return The undo data for `unmakeMove`.
+ */
+MoveUndo Search::makeMove(uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    moveStack[currentPly()] = move;
+    pieceStack[currentPly()] = board.pieceOn(fromSquare);
+    MoveUndo undoData = applyMove(board, move);
+    capturedStack[currentPly()] = undoData.capturedPiece;
+    keyStack.push_back(board.getZobristHash());
+    return undoData;
+}
+
+/**
+ * Takes back a move played with `makeMove`.
+ *
+ * @param undoData The undo data returned by `makeMove`.
+ */
+void Search::unmakeMove(const MoveUndo& undoData) {
+    keyStack.pop_back();
+    undoMove(board, undoData);
+}
+
+/**
+ * Tells whether the side to move has a piece other than pawns and its king.
+ *
+ * - Null move pruning is skipped without one: in king and pawn endings zugzwang is common,
+ *   and passing would be the best move.
+ *
+ * @param board The current board state.
+ * @return True if the side to move has a knight, bishop, rook or queen.
+ */
+static bool hasNonPawnMaterial(const BoardState& board) {
+    int first = board.getTurn() ? WHITE_KNIGHTS : BLACK_KNIGHTS;
+    for (int piece = first; piece < first + 4; ++piece) {
+        if (board.getBitboard(piece)) return true;
+    }
+    return false;
+}
+
+/**
+ * Passes the turn on the search board, for null move pruning.
+ *
+ * - Recorded on the key stack like a move; the piece stack gets NO_PIECE, so there is no
+ *   counter move or continuation history for the reply.
+ *
+ * @return The undo data for `unmakeNullMove`.
+ */
+MoveUndo Search::makeNullMove() {
+    moveStack[currentPly()] = 0;
+    pieceStack[currentPly()] = NO_PIECE;
+    capturedStack[currentPly()] = NO_PIECE;
+    extensionStack[currentPly() + 1] = extensionStack[currentPly()];
+    MoveUndo undoData = applyNullMove(board);
+    keyStack.push_back(board.getZobristHash());
+    return undoData;
+}
+
+/**
+ * Takes back a null move played with `makeNullMove`.
+ *
+ * @param undoData The undo data returned by `makeNullMove`.
+ */
+void Search::unmakeNullMove(const MoveUndo& undoData) {
+    keyStack.pop_back();
+    undoNullMove(board, undoData);
+}
+
+/**
+ * Checks whether the current position repeats an earlier one.
+ *
+ * - Only the positions since the last irreversible move can repeat, so the scan is bounded
+ *   by the halfmove clock. It also stops at the last null move on the search path, as
+ *   a position reached by passing the turn was never really on the board.
+ * - The side to move must match, so only every second ply is compared, starting four
+ *   plies back (the closest a position can repeat).
+ * - A single repetition inside the search tree counts as a draw, since the side that
+ *   allowed it could repeat again. A position that only repeats the root or game
+ *   history needs to have occurred twice before (a real threefold repetition).
+ *
+ * @return True if the position should be scored as a draw by repetition.
+ */
+bool Search::isRepetition() const {
+    int current = int(keyStack.size()) - 1;
+    int distance = std::min(board.getHalfmoveClock(), current);
+    int ply = currentPly();
+    for (int back = 1; back <= std::min(distance, ply); ++back) {
+        if (moveStack[ply - back] == 0) {  // Null move
+            distance = back - 1;
+            break;
         }
+    }
+    uint64_t key = keyStack[current];
+    int previousOccurrences = 0;
+
+    for (int i = 4; i <= distance; i += 2) {
+        int index = current - i;
+        if (keyStack[index] == key) {
+            if (index > rootIndex || ++previousOccurrences >= 2) {
+                return true;
+            }
+        }
+    }
     return false;
 }
 
+/**
+ * Converts a score relative to the root into one relative to the current node, for
+ * storing in the transposition table. Mate scores count plies from the root, but the
+ * same position can be reached at different plies.
+ *
+ * @param score The score of the node.
+ * @param ply The distance of the node from the root.
+ * @return The score to store.
+ */
+static int scoreToTT(int score, int ply) {
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+/**
+ * Converts a score read from the transposition table back to one relative to the root.
+ *
+ * @param score The stored score.
+ * @param ply The distance of the node from the root.
+ * @return The score of the node.
+ */
+static int scoreFromTT(int score, int ply) {
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
+/**
+ * Formats a score for UCI: centipawns, or moves to mate.
+ *
+ * @param score The score from the side to move's point of view.
+ * @return "cp <x>" or "mate <n>" (negative when we are getting mated).
+ */
+static std::string scoreToUci(int score) {
+    if (score >= MATE_BOUND) return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+    if (score <= -MATE_BOUND) return "mate " + std::to_string(-(MATE_SCORE + score) / 2);
+    return "cp " + std::to_string(score);
+}
+
+/**
+ * Makes `move` followed by the child's best line the best line at `ply`.
+ *
+ * @param ply The ply of the node whose best move was just found.
+ * @param move The new best move.
+ */
+void Search::updatePV(int ply, uint16_t move) {
+    pvTable[ply][ply] = move;
+    for (int i = ply + 1; i < pvLength[ply + 1]; ++i) {
+        pvTable[ply][i] = pvTable[ply + 1][i];
+    }
+    pvLength[ply] = std::max(ply + 1, pvLength[ply + 1]);
+}
+
+/**
+ * Sends the UCI info line for a completed iteration.
+ *
+ * @param depth The depth of the iteration.
+ * @param score The score of the best move.
+ */
+void Search::printIterationInfo(int depth, int score) {
+    uint64_t nodes = pool ? pool->nodesSearched() : stats.nodes.load();
+    int64_t elapsed = timeManager.elapsedMs();
+
+    std::string line = "info depth " + std::to_string(depth) + " seldepth " +
+                       std::to_string(selDepth) + " score " + scoreToUci(score) + " nodes " +
+                       std::to_string(nodes) + " nps " +
+                       std::to_string(nodes * 1000 / std::max<int64_t>(1, elapsed)) + " time " +
+                       std::to_string(elapsed) + " hashfull " + std::to_string(table.hashfull()) +
+                       " pv";
+    for (uint16_t move : rootPV) {
+        line += " " + moveToString(move);
+    }
+    uciOutput.write(line);
+}
+
 /**
  * @brief Performs Quiescence Search to refine evaluation in tactical positions.
  *
- * Quiescence Search extends the search at leaf nodes by considering only captures,
- * promotions, and checks to avoid the horizon effect. It ensures that unstable positions
- * are evaluated more accurately.
+ * Quiescence Search extends the search at leaf nodes by considering only captures and
+ * promotions, to avoid the horizon effect. It ensures that unstable positions are
+ * evaluated more accurately.
  *
- * The function follows these steps:
- * 1. Checks if the search should stop due to time constraints.
- * 2. Evaluates the current position (stand pat).
- * 3. If stand pat exceeds beta, pruning occurs.
- * 4. Otherwise, captures, promotions, and checks are explored recursively.
- * 5. The best found score is returned.
+ * - Out of check, the static evaluation is a lower bound (stand pat) and only captures and
+ *   promotions are searched, plus quiet checks on the first ply if the QSearchChecks
+ *   option is set. Captures that lose material by SEE are left out by the move picker.
+ * - Probes and stores the transposition table under depth QS_DEPTH_CHECKS where quiet
+ *   checks were searched, and QS_DEPTH_NO_CHECKS where they were not.
+ * - Delta pruning skips captures that stay short of alpha even with DELTA_MARGIN to spare,
+ *   unless they promote or give check.
+ * - In check, every evasion is searched and no legal move means mate.
+ * - Fails soft: a score outside the window is a bound, stored as one.
  *
  * @param alpha The alpha bound (best guaranteed score for the maximizing player).
  * @param beta The beta bound (best guaranteed score for the minimizing player).
+ * @param depth QS_DEPTH_CHECKS on the first ply, QS_DEPTH_NO_CHECKS below it.
  * @return The evaluation score for the position.
  */
-int Search::QSearch(int alpha, int beta) {
+int Search::QSearch(int alpha, int beta, int depth) {
+    int ply = currentPly();
+    pvLength[ply] = ply;  // Quiescence search does not extend the PV
     if (shouldStopSearch()) {
-        return 0;
+        return evaluate(board);  // Discarded by the caller, but not mistaken for a draw
     }
-    int standPat = evaluate(board);
-    if (standPat >= beta) return beta;
-    if (standPat > alpha) alpha = standPat;
-    
-    std::vector<uint16_t> allMoves = allLegalMoves(board);
-    std::vector<uint16_t> checksAndCaptures = goodCaptureOrChecks(board, allMoves);
-    for (uint16_t move : checksAndCaptures) {
-        MoveUndo undoState = applyMove(board, move);
-        int score = -QSearch(-beta, -alpha);
-        undoMove(board, undoState);
+    countNode();
+    selDepth = std::max(selDepth, ply);
+    if (ply >= MAX_SEARCH_PLY) return evaluate(board);
+
+    bool checks = pruning.qsearchChecks && depth >= QS_DEPTH_CHECKS;
+    depth = checks ? QS_DEPTH_CHECKS : QS_DEPTH_NO_CHECKS;
+    uint64_t zobristHash = board.getZobristHash();
+    TranspositionTableEntry entry;
+    uint16_t ttMove = 0;
+    stats.ttProbes++;
+    if (getTranspositionTableEntry(table, zobristHash, entry)) {
+        stats.ttHits++;
+        if (isPseudoLegal(board, entry.bestMove) && isLegal(board, entry.bestMove)) {
+            ttMove = entry.bestMove;
+        }
+        int ttScore = scoreFromTT(entry.evaluation, ply);
+        if (entry.depth >= depth &&
+            (entry.eval_type == EXACT_SCORE ||
+             (entry.eval_type == UPPERBOUND_SCORE && ttScore <= alpha) ||
+             (entry.eval_type == LOWERBOUND_SCORE && ttScore >= beta))) {
+            stats.ttCutoffs++;
+            return ttScore;
+        }
+    }
+
+    bool inCheck = board.getCheckers() != 0;
+    int alphaOriginal = alpha;
+    int bestScore = -999999;
+    int standPat = 0;
+    if (!inCheck) {
+        standPat = evaluate(board);
+        if (standPat >= beta) {
+            updateTranspositionTable(table, zobristHash, 0, scoreToTT(standPat, ply), depth,
+                                     LOWERBOUND_SCORE);
+            return standPat;
+        }
+        bestScore = standPat;
+        alpha = std::max(alpha, standPat);
+    }
+
+    MovePicker picker(board, ttMove, *history, checks);
+    uint16_t bestMove = 0;
+    int movesSearched = 0;
+    while (uint16_t move = picker.nextMove()) {
+        if (!inCheck) {
+            int fromSquare, toSquare, special;
+            decodeMove(move, fromSquare, toSquare, special);
+            int victim = special == EN_PASSANT ? WHITE_PAWNS : board.pieceOn(toSquare);
+            int futilityScore = standPat + DELTA_MARGIN +
+                                (victim == NO_PIECE ? 0 : std::abs(MATERIAL_SCORES[victim]));
+            if (futilityScore <= alpha && special != PROMOTION_QUEEN &&
+                !givesCheck(board, move)) {
+                bestScore = std::max(bestScore, futilityScore);
+                continue;
+            }
+        }
+
+        MoveUndo undoState = makeMove(move);
+        movesSearched++;
+        int score = -QSearch(-beta, -alpha, QS_DEPTH_NO_CHECKS);
+        unmakeMove(undoState);
 
-        if (score >= beta) return beta;
-        if (score > alpha) alpha = score;
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                bestMove = move;
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
     }
 
-    return alpha;
+    if (inCheck && movesSearched == 0) {
+        return -MATE_SCORE + ply;  // Checkmate: every evasion was tried
+    }
+    if (!searchInterrupted) {
+        int flag = bestScore >= beta ? LOWERBOUND_SCORE
+                   : bestScore > alphaOriginal ? EXACT_SCORE : UPPERBOUND_SCORE;
+        updateTranspositionTable(table, zobristHash, bestMove, scoreToTT(bestScore, ply), depth,
+                                 flag);
+    }
+    return bestScore;
 }
 
 
 bool debugnm = false;
 bool debuggbm = false;
 
+/**
+ * Scores a finished game and stores the score in the transposition table.
+ *
+ * - Being mated scores -MATE_SCORE plus the ply, so a later mate is preferred.
+ * - Every kind of draw scores 100.
+ *
+ * @param result The game result of the current position, not ONGOING.
+ * @param depth The depth the position was to be searched to.
+ * @return The score of the position for the side to move.
+ */
+int Search::gameOverScore(GameResult result, int depth) {
+    int ply = currentPly();
+    uint64_t zobristHash = board.getZobristHash();
+    if (result == WHITE_WINS || result == BLACK_WINS) {
+        if (debugnm) std::cout << "Game over at depth " << depth << ": ";
+        if (debugnm)
+            std::cout << ((result == WHITE_WINS) ? "White wins" : "Black wins") << "\n";
+        if (debugnm) std::cout << board << "\n";
+        int mateScore = -MATE_SCORE + ply;  // Getting mated sooner is worse
+        updateTranspositionTable(table, zobristHash, 0, scoreToTT(mateScore, ply), depth,
+                                 EXACT_SCORE);
+        return mateScore;
+    }
+
+    //The game is a draw for any of four reasons
+    if (debugnm){
+        std::cout << result << "\n";
+        std::cout << "Game drawn at depth " << depth << "due to \n";
+        switch (result)
+        {
+        case DRAW_STALEMATE:
+            std::cout << "STALEMATE\n";
+            break;
+        case DRAW_INSUFFICIENT_MATERIAL:
+            std::cout << "DRAW_INSUFFICIENT_MATERIAL\n";
+            break;
+        case DRAW_50_MOVE_RULE:
+            std::cout << "50MOVERULE\n";
+            break;
+        default:
+            break;
+        }
+    }
+    updateTranspositionTable(table, zobristHash, 0, 100, depth, EXACT_SCORE);
+    return 100;
+}
+
+/**
+ * Finds the continuation history row of an earlier move on the current path.
+ *
+ * @param ply The ply of the current node.
+ * @param pliesBack How many plies back the move was played, 1 for the previous move.
+ * @return The row indexed by that move's piece and destination, or nullptr if there is none.
+ */
+PieceToHistory* Search::continuationRow(int ply, int pliesBack) const {
+    if (ply < pliesBack || pieceStack[ply - pliesBack] == NO_PIECE) return nullptr;
+    int fromSquare, toSquare, special;
+    decodeMove(moveStack[ply - pliesBack], fromSquare, toSquare, special);
+    return &history->continuation[pieceStack[ply - pliesBack]][toSquare];
+}
+
+/**
+ * Reads a quiet move's butterfly and continuation history, as the move picker orders by.
+ *
+ * @param history The history tables of the searching thread.
+ * @param board The position the move is played in.
+ * @param continuation The continuation rows of the moves 1 and 2 plies back, or nullptr.
+ * @param move The quiet move.
+ * @return The summed history score.
+ */
+static int quietHistoryScore(const HistoryTables& history, const BoardState& board,
+                             const PieceToHistory* const continuation[CONTINUATION_PLIES],
+                             uint16_t move) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    int pieceType = board.pieceOn(fromSquare);
+    int score = history.butterfly[board.getTurn() ? 0 : 1][fromSquare][toSquare];
+    for (int i = 0; i < CONTINUATION_PLIES; ++i) {
+        if (continuation[i]) score += (*continuation[i])[pieceType][toSquare];
+    }
+    return score;
+}
+
+/**
+ * Updates a quiet move's butterfly and continuation history.
+ *
+ * @param history The history tables of the searching thread.
+ * @param board The position the move was played in.
+ * @param continuation The continuation rows of the moves 1 and 2 plies back, or nullptr.
+ * @param move The quiet move.
+ * @param bonus The bonus, negative for a malus.
+ */
+static void updateQuietHistory(HistoryTables& history, const BoardState& board,
+                               PieceToHistory* const continuation[CONTINUATION_PLIES],
+                               uint16_t move, int bonus) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    int pieceType = board.pieceOn(fromSquare);
+    updateHistory(history.butterfly[board.getTurn() ? 0 : 1][fromSquare][toSquare], bonus);
+    for (int i = 0; i < CONTINUATION_PLIES; ++i) {
+        if (continuation[i]) updateHistory((*continuation[i])[pieceType][toSquare], bonus);
+    }
+}
+
+/**
+ * Updates a capture's capture history.
+ *
+ * - Queen promotions without a capture have no captured piece and are left alone.
+ *
+ * @param history The history tables of the searching thread.
+ * @param board The position the move was played in.
+ * @param move The capture.
+ * @param bonus The bonus, negative for a malus.
+ */
+static void updateCaptureHistory(HistoryTables& history, const BoardState& board,
+                                 uint16_t move, int bonus) {
+    int fromSquare, toSquare, special;
+    decodeMove(move, fromSquare, toSquare, special);
+    int captured = special == EN_PASSANT ? WHITE_PAWNS : board.pieceOn(toSquare);
+    if (captured == NO_PIECE) return;
+    updateHistory(history.captures[board.pieceOn(fromSquare)][toSquare][captured % 6], bonus);
+}
+
+/**
+ * Learns from a beta cutoff.
+ *
+ * - A quiet cutoff move becomes the first killer of the ply and the counter move to the
+ *   previous move, and gains butterfly and continuation history; the quiets searched
+ *   before it lose the same amount.
+ * - A capture cutoff move gains capture history.
+ * - Either way, the captures searched before the cutoff move lose capture history.
+ *
+ * @param ply The ply of the node.
+ * @param depth The depth the node was searched to, which sets the size of the bonus.
+ * @param bestMove The move that caused the cutoff.
+ * @param quietsTried The first quiet moves searched before it.
+ * @param capturesTried The first captures searched before it.
+ */
+void Search::updateHistories(int ply, int depth, uint16_t bestMove,
+                             const BoundedMoveList<HISTORY_MOVES_TRIED>& quietsTried,
+                             const BoundedMoveList<HISTORY_MOVES_TRIED>& capturesTried) {
+    int bonus = historyBonus(depth);
+    if (!isNoisy(board, bestMove)) {
+        if (killers[ply][0] != bestMove) {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = bestMove;
+        }
+        if (ply > 0 && pieceStack[ply - 1] != NO_PIECE) {
+            int fromSquare, toSquare, special;
+            decodeMove(moveStack[ply - 1], fromSquare, toSquare, special);
+            history->counterMoves[pieceStack[ply - 1]][toSquare] = bestMove;
+        }
+
+        PieceToHistory* continuation[CONTINUATION_PLIES] = {continuationRow(ply, 1),
+                                                            continuationRow(ply, 2)};
+        updateQuietHistory(*history, board, continuation, bestMove, bonus);
+        for (uint16_t move : quietsTried) {
+            updateQuietHistory(*history, board, continuation, move, -bonus);
+        }
+    } else {
+        updateCaptureHistory(*history, board, bestMove, bonus);
+    }
+    for (uint16_t move : capturesTried) {
+        updateCaptureHistory(*history, board, move, -bonus);
+    }
+}
+
 /**
  * Implements the Negamax search algorithm with alpha-beta pruning.
  *
- * - Uses a transposition table to avoid redundant calculations.
- * - Detects threefold repetition and game-ending conditions early.
- * - Incorporates move ordering for better pruning efficiency.
+ * - Uses a transposition table to avoid redundant calculations, and tries its move first.
+ * - Detects repetitions and game-ending conditions early.
+ * - Takes moves from a staged MovePicker, so ordering work stops at a cutoff.
+ * - Principal variation search: moves after the first are searched with a zero window
+ *   and only re-searched with the full window when they beat alpha.
  * - Calls Quiescence Search (QSearch) when reaching depth 0.
- * - Implements a visit count mechanism to handle threefold repetition correctly.
+ * - Uses the ply-indexed key stack to detect repetitions along the game and search path.
+ * - In ABDADA mode, defers moves (other than the first) that another thread is already
+ *   searching at the same node, and searches them last.
  *
  * @param depth  The current search depth.
  * @param alpha  The lower bound of the best score found so far.
@@ -517,30 +978,41 @@ bool debuggbm = false;
  * @return       The evaluated score of the position.
  */
 int Search::negamax(int depth, int alpha, int beta) {
+    int ply = currentPly();
+    pvLength[ply] = ply;
     if (shouldStopSearch()) {
         return 0; // Stop searching if time is up
     }
 
+    countNode();
+    selDepth = std::max(selDepth, ply);
+    if (ply >= MAX_SEARCH_PLY) return evaluate(board);
     uint64_t zobristHash = board.getZobristHash();
 
-    // Track position visits for threefold repetition detection
-    incrementVisitCount(table, zobristHash);
-
-    if(threefold(table, zobristHash)) {
-        // Threefold repetition detected → Draw (score = 100)
-        // Viewed from the otherside, the three-fold is -100, meaning
-        // we will try to avoid three-folds unless we are in a worse position
-        // than -100.
-        updateTranspositionTable(table, zobristHash, 0, 100, depth, EXACT_SCORE);
-        decrementVisitCount(table, zobristHash);
+    if (isRepetition()) {
+        // Repetition detected → Draw (score = 100)
+        // Viewed from the otherside, the repetition is -100, meaning
+        // we will try to avoid repetitions unless we are in a worse position
+        // than -100. The score depends on the path, so it is not stored.
         return 100;
     }
     
-    // Check if the position is already stored in the transposition table
-    auto it = table.find(zobristHash);
-    if (it != table.end()) {
+    // A singular extension search leaves out one move, so its result is not the position's
+    // and the transposition table is neither used nor updated
+    uint16_t excludedMove = excludedMoves[ply];
 
-        const TranspositionTableEntry& entry = it->second;
+    // Check if the position is already stored in the transposition table
+    TranspositionTableEntry entry;
+    uint16_t ttMove = 0;
+    stats.ttProbes++;
+    if (!excludedMove && getTranspositionTableEntry(table, zobristHash, entry)) {
+        stats.ttHits++;
+        // The stored move is tried first, once it is known to be legal here: on a key
+        // collision it can be any move of another position
+        if (isPseudoLegal(board, entry.bestMove) && isLegal(board, entry.bestMove)) {
+            ttMove = entry.bestMove;
+        }
+        entry.evaluation = scoreFromTT(entry.evaluation, ply);
 
         // If depth is sufficient, use stored evaluation
         if (entry.depth >= depth) {
@@ -550,94 +1022,226 @@ int Search::negamax(int depth, int alpha, int beta) {
                           << " which is better than current depth " << depth << "\n";
                 std::cout << "returning " << entry.evaluation << "\n";
             }
-            decrementVisitCount(table, zobristHash);
             // Return stored evaluation based on the type of bound
-            if (entry.eval_type == EXACT_SCORE) return entry.evaluation;
-            if (entry.eval_type == UPPERBOUND_SCORE && entry.evaluation <= alpha)
-                return entry.evaluation;
-            if (entry.eval_type == LOWERBOUND_SCORE && entry.evaluation >= beta)
+            if (entry.eval_type == EXACT_SCORE ||
+                (entry.eval_type == UPPERBOUND_SCORE && entry.evaluation <= alpha) ||
+                (entry.eval_type == LOWERBOUND_SCORE && entry.evaluation >= beta)) {
+                stats.ttCutoffs++;
                 return entry.evaluation;
+            }
         }
     }
 
-    // Generate all legal moves in the current position. Used for determining if the game is over
-    std::vector<uint16_t> legalMoves = allLegalMoves(board);
-
-    // Base case: if the depth is 0 or game over, return the evaluation of the position
-    GameResult result = gameOver(board, legalMoves, table);
+    // Where a draw by rule may apply, the moves are generated up front so a mate still takes
+    // precedence. Elsewhere the move picker generates them, and a node without legal moves
+    // is one where it hands out none; at the horizon, quiescence search finds mates itself.
+    GameResult result = ONGOING;
+    if (fiftyMoveRule(board) || insufficientMaterial(board)) {
+        MoveList legalMoves = allLegalMoves(board);
+        result = gameOver(board, legalMoves);
+    }
 
     int moveIndex = 0;
     if (result != ONGOING) {
-        if (result == WHITE_WINS || result == BLACK_WINS) {
-            if (debugnm) std::cout << "Game over at depth " << depth << ": ";
-            if (debugnm)
-                std::cout << ((result == WHITE_WINS) ? "White wins" : "Black wins") << "\n";
-            if (debugnm) std::cout << board << "\n";
-            int mateScore = -99999 - depth;
-            updateTranspositionTable(table, zobristHash, 0, mateScore, depth, EXACT_SCORE);
-            decrementVisitCount(table, zobristHash);
-            return mateScore;
-        }
-
-        //The game is a draw for any of four reasons
-        if (debugnm){
-            std::cout << result << "\n";
-            std::cout << "Game drawn at depth " << depth << "due to \n";
-            switch (result)
-            {
-            case DRAW_STALEMATE:
-                std::cout << "STALEMATE\n";
-                break;
-            case DRAW_INSUFFICIENT_MATERIAL:
-                std::cout << "DRAW_INSUFFICIENT_MATERIAL\n";
-                break;
-            case DRAW_50_MOVE_RULE:
-                std::cout << "50MOVERULE\n";
-                break;
-            case DRAW_THREEFOLD_REPETITION:
-                std::cout << "THREEFOLD\n";
-                break;
-            default:
-                break;
-            }
-        }
-        updateTranspositionTable(table, zobristHash, 0, 100, depth, EXACT_SCORE);
-        decrementVisitCount(table, zobristHash);
-        return 100;
+        return gameOverScore(result, depth);
     }
     if (depth == 0) {
+        // Quiescence search stores its own result, under the same depth
         int eval = QSearch(alpha, beta);
-        updateTranspositionTable(table, zobristHash, 0, eval, depth, EXACT_SCORE);
         if (debugnm) std::cout << "Evaluating leaf node at depth 0: eval = " << eval << "\n";
         if (debugnm) std::cout << board << "\n";
-        decrementVisitCount(table, zobristHash);
         return eval;
     }
 
-    // Now that we know we will iterate through the legal moves its worthwhile to go through the
-    // effort of ordering them
-    legalMoves = orderMoves(board, legalMoves);
+    // Forward pruning, only at zero window nodes outside check
+    bool pvNode = beta - alpha > 1;
+    bool inCheck = is_in_check(board);
+    bool canPrune = !pvNode && !inCheck && !excludedMove && std::abs(beta) < MATE_BOUND;
+    int staticEval = inCheck ? -999999 : evaluate(board);
+
+    // Reverse futility: far enough above beta that no reply at this depth brings it back
+    if (canPrune && pruning.reverseFutility && depth <= REVERSE_FUTILITY_MAX_DEPTH &&
+        staticEval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+        return staticEval;
+    }
+
+    // Razoring: far below alpha near the horizon, trust the captures to show any way back
+    if (canPrune && pruning.razoring && depth <= RAZORING_MAX_DEPTH &&
+        staticEval + RAZORING_MARGIN * depth < alpha) {
+        int eval = QSearch(alpha, alpha + 1);
+        if (eval <= alpha) return eval;
+    }
+
+    // Null move: if passing still fails high, a real move would too
+    if (canPrune && pruning.nullMove && !verifyingNullMove && depth >= NULL_MOVE_MIN_DEPTH &&
+        staticEval >= beta && ply > 0 && pieceStack[ply - 1] != NO_PIECE &&
+        hasNonPawnMaterial(board)) {
+        int reduction = 3 + depth / 3 + std::min((staticEval - beta) / 200, 3);
+        MoveUndo undoData = makeNullMove();
+        int score = -negamax(std::max(0, depth - reduction), -beta, -beta + 1);
+        unmakeNullMove(undoData);
+        if (searchInterrupted) return 0;
+
+        if (score >= beta) {
+            if (score >= MATE_BOUND) score = beta;  // A mate after passing proves nothing
+            if (depth < NULL_MOVE_VERIFY_DEPTH) return score;
+
+            // Deep cutoffs are confirmed by a reduced search without null moves, which
+            // catches the zugzwangs the material guard lets through
+            verifyingNullMove = true;
+            int verified = negamax(std::max(1, depth - reduction), beta - 1, beta);
+            verifyingNullMove = false;
+            if (verified >= beta) return score;
+        }
+    }
+
+    // Futility: near the horizon, quiet moves cannot lift a hopeless static eval to alpha
+    bool futile = canPrune && pruning.futility && depth <= FUTILITY_MAX_DEPTH &&
+                  staticEval + FUTILITY_MARGIN * depth <= alpha;
+
+    // Moves come out of the picker best first, each stage only ordered once it is reached
+    const PieceToHistory* continuation[CONTINUATION_PLIES] = {continuationRow(ply, 1),
+                                                              continuationRow(ply, 2)};
+    uint16_t counterMove = 0;
+    if (ply > 0 && pieceStack[ply - 1] != NO_PIECE) {
+        int fromSquare, toSquare, special;
+        decodeMove(moveStack[ply - 1], fromSquare, toSquare, special);
+        counterMove = history->counterMoves[pieceStack[ply - 1]][toSquare];
+    }
+    MovePicker picker(board, ttMove, *history, killers[ply], counterMove, continuation);
+    // Searched without a cutoff, for the history malus; the first HISTORY_MOVES_TRIED of each
+    BoundedMoveList<HISTORY_MOVES_TRIED> quietsTried, capturesTried;
+    BoundedMoveList<ABDADA_DEFER_SLOTS> deferredMoves;  // Moves another thread was searching
+    size_t deferredIndex = 0;
+    int movesSearched = 0;
+    int moveCount = 0;  // Moves handed out so far, pruned ones included
     int bestScore = -999999;
     uint16_t bestMoveNM = 0;
     int alpha_original = alpha;
-    for (const uint16_t& move : legalMoves) {
-        MoveUndo undoData = applyMove(board, move);
+    while (true) {
+        uint16_t move = picker.nextMove();
+        uint64_t moveKey = 0;
+        if (move && move == excludedMove) continue;  // Before it could be marked as searching
+        if (!move) {
+            if (deferredIndex == deferredMoves.size()) break;
+            move = deferredMoves[deferredIndex++];
+        } else if (searchingMoves && movesSearched > 0 && depth >= ABDADA_DEFER_DEPTH) {
+            moveKey = SearchingMovesTable::moveKey(zobristHash, move);
+            // Once the deferred list is full, moves are searched right away after all
+            if (searchingMoves->isSearching(moveKey) && !deferredMoves.full()) {
+                deferredMoves.push_back(move);
+                continue;
+            }
+            searchingMoves->startSearching(moveKey);
+        }
+        moveCount++;
+
+        // Quiet moves that do not give check can be pruned or reduced once one move is searched
+        bool lateQuiet = movesSearched > 0 && !isNoisy(board, move) && !givesCheck(board, move);
+        if (lateQuiet && futile) {
+            if (moveKey) searchingMoves->finishSearching(moveKey);
+            bestScore = std::max(bestScore, staticEval + FUTILITY_MARGIN * depth);
+            continue;
+        }
+        if (lateQuiet && canPrune && pruning.lateMovePruning &&
+            depth <= LATE_MOVE_PRUNING_MAX_DEPTH && moveCount > 3 + depth * depth &&
+            bestScore > -MATE_BOUND) {
+            if (moveKey) searchingMoves->finishSearching(moveKey);
+            continue;
+        }
+        int reduction = 0;
+        if (lateQuiet && pruning.lateMoveReductions && depth >= LMR_MIN_DEPTH) {
+            reduction = reductionTable[depth][moveCount];
+            if (pvNode) reduction--;
+            if (inCheck) reduction--;
+            reduction -= quietHistoryScore(*history, board, continuation, move) /
+                         LMR_HISTORY_DIVISOR;
+            reduction = std::max(0, std::min(reduction, depth - 2));
+        }
+
+        int extension = 0;
+        if (extensionStack[ply] * EXTENSION_PLY_RATE <= ply) {
+            // Singular: the TT move is extended when every other move falls well short of its
+            // score. When even the others reach beta, the node fails high without searching.
+            if (move == ttMove && pruning.singularExtension && depth >= SINGULAR_MIN_DEPTH &&
+                !excludedMove && entry.depth >= depth - SINGULAR_TT_DEPTH_MARGIN &&
+                entry.eval_type != UPPERBOUND_SCORE && std::abs(entry.evaluation) < MATE_BOUND) {
+                int singularBeta = entry.evaluation - SINGULAR_MARGIN * depth;
+                excludedMoves[ply] = move;
+                int score = negamax((depth - 1) / 2, singularBeta - 1, singularBeta);
+                excludedMoves[ply] = 0;
+                if (searchInterrupted) return 0;
+                if (score < singularBeta) {
+                    extension = 1;
+                } else if (singularBeta >= beta) {
+                    return singularBeta;
+                }
+            }
+            if (!extension && pruning.checkExtension && givesCheck(board, move)) {
+                extension = 1;
+            }
+            // Recaptures on the square just captured on keep the exchange on the board,
+            // along the principal variation only
+            if (!extension && pruning.recaptureExtension && pvNode && ply > 0 &&
+                capturedStack[ply - 1] != NO_PIECE) {
+                int fromSquare, toSquare, special, previousTo;
+                decodeMove(moveStack[ply - 1], fromSquare, previousTo, special);
+                decodeMove(move, fromSquare, toSquare, special);
+                if (toSquare == previousTo && board.pieceOn(toSquare) != NO_PIECE) extension = 1;
+            }
+        }
+        int newDepth = depth - 1 + extension;
+        extensionStack[ply + 1] = extensionStack[ply] + extension;
+        MoveUndo undoData = makeMove(move);
+        movesSearched++;
         if (debugnm)
         std::cout << "Depth " << depth << ", Move " << moveIndex << ": " << moveToString(move)
         << "\n";
-        int score = -negamax(depth - 1, -beta, -alpha);
-        undoMove(board, undoData);
-        
+        // Principal variation search: only the first move is searched with the full window.
+        // Late quiet moves are searched reduced first, and again to full depth if they
+        // beat alpha all the same.
+        int score;
+        if (movesSearched == 1) {
+            score = -negamax(newDepth, -beta, -alpha);
+        } else {
+            score = -negamax(newDepth - reduction, -alpha - 1, -alpha);
+            if (score > alpha && reduction > 0) {
+                score = -negamax(newDepth, -alpha - 1, -alpha);
+            }
+            if (score > alpha && score < beta) {
+                score = -negamax(newDepth, -beta, -alpha);
+            }
+        }
+        unmakeMove(undoData);
+        if (moveKey) searchingMoves->finishSearching(moveKey);
+        // The child's score is meaningless once the search was stopped
+        if (searchInterrupted) return 0;
+
         if (score > bestScore) {
             bestScore = score;
             if (score > alpha) {
                 alpha = score;
+                updatePV(ply, move);
             }
             bestMoveNM = move;
         }
         if (alpha >= beta) {
+            stats.betaCutoffs++;
+            if (movesSearched == 1) stats.firstMoveCutoffs++;
+            updateHistories(ply, depth, move, quietsTried, capturesTried);
             break;  // Beta-cutoff
         }
+        if (isNoisy(board, move)) {
+            capturesTried.push_back(move);
+        } else {
+            quietsTried.push_back(move);
+        }
+    }
+    if (movesSearched == 0) {
+        // Only the excluded move, if any, was legal: it alone reaches the score
+        if (excludedMove) return alpha;
+        // No legal moves: checkmate or stalemate
+        return gameOverScore(gameOver(board, MoveList()), depth);
     }
     int flag = 0;
     if (bestScore <= alpha_original) {
@@ -649,10 +1253,10 @@ int Search::negamax(int depth, int alpha, int beta) {
     }
 
     // Update transposition table with the correct score type
-    updateTranspositionTable(table, zobristHash, bestMoveNM, bestScore, depth, flag);
-
-    // Decrement visit count after recursion completes
-    decrementVisitCount(table, zobristHash);
+    if (!excludedMove && !searchInterrupted) {
+        updateTranspositionTable(table, zobristHash, bestMoveNM, scoreToTT(bestScore, ply),
+                                 depth, flag);
+    }
 
     return bestScore;
 }
@@ -661,91 +1265,218 @@ int Search::negamax(int depth, int alpha, int beta) {
  * Determines the best move for the current position using the negamax search algorithm.
  *
  * - Iterates through `orderedLegalMoves` to evaluate each move.
- * - Uses `negamax` to recursively determine the evaluation of each move.
- * - Keeps track of the best move found so far, updating `bestMoveSoFar` and `bestEvalSoFar`.
- * - Uses alpha-beta pruning to improve efficiency.
+ * - Principal variation search: the first move gets the window, every later one a zero
+ *   window around alpha first, and a re-search with the window only if it beats alpha.
+ * - Keeps track of the best move found so far, updating `bestMoveSoFar` and `bestEvalSoFar`
+ *   whenever a move beats alpha, so a move that fails high is kept as well.
+ * - Returns as soon as a move reaches beta; the caller widens the window.
  * - Stores move evaluations in `scoredMoves` for potential reordering in iterative deepening.
  * - Stops searching if `shouldStopSearch()` is triggered.
+ * - Keeps the principal variation of the best move in `rootPV`, and reports the move being
+ *   searched (currmove) once the search has run for a while.
  *
  * @param depth The depth to search for the best move.
+ * @param alpha The lower bound of the root window.
+ * @param beta The upper bound of the root window.
+ * @return The best score found, a bound if it is outside the window.
  */
-void Search::getBestMove(int depth) {
-    int alpha = -999999;
-    int beta = 999999;
+int Search::getBestMove(int depth, int alpha, int beta) {
+    int bestScore = -999999;
 
     if (debuggbm) std::cout << "Evaluating moves at depth " << depth << "\n";
     int moveIndex = 0; //remember to delete, only useflu for logs
-    for (const uint16_t& move : orderedLegalMoves) {
+    for (uint16_t move : orderedLegalMoves) {
         if (shouldStopSearch()) {
-            return;
+            break;
+        }
+        if (printInfo && timeManager.elapsedMs() >= CURRMOVE_MIN_TIME_MS) {
+            uciOutput.writeThrottled("info depth " + std::to_string(depth) + " currmove " +
+                                     moveToString(move) + " currmovenumber " +
+                                     std::to_string(moveIndex + 1));
         }
         
-        MoveUndo undoData = applyMove(board, move);
+        MoveUndo undoData = makeMove(move);
         if (debuggbm) std::cout << "Testing move " << moveIndex << ": " << moveToString(move) << "\n";
-        // Determine if we're maximizing for white (positive) or black (negative)
-        int eval = -negamax(depth - 1, -beta, -alpha);
-        undoMove(board, undoData);
-        scoredMoves.emplace_back(eval, move);
+        int eval;
+        if (moveIndex == 0) {
+            eval = -negamax(depth - 1, -beta, -alpha);
+        } else {
+            eval = -negamax(depth - 1, -alpha - 1, -alpha);
+            if (eval > alpha && eval < beta) {
+                eval = -negamax(depth - 1, -beta, -alpha);
+            }
+        }
+        unmakeMove(undoData);
+        if (searchInterrupted) break;
+        scoredMoves.push_back(move, eval);
         if (debuggbm) std::cout << "Move " << moveToString(move) << " -> gbm eval = " << eval
                   << ", bestEval = " << bestEvalSoFar << "\n";
 
-        if (move == bestMoveSoFar && eval != bestEvalSoFar) {
-            bestEvalSoFar = eval;
-        }
-
-        if (eval > bestEvalSoFar && !searchInterrupted) {
+        bestScore = std::max(bestScore, eval);
+        if (eval > alpha) {
+            alpha = eval;
             bestEvalSoFar = eval;
             bestMoveSoFar = move;
+            // The best move followed by the line the child search found for it
+            rootPV.assign(1, move);
+            rootPV.insert(rootPV.end(), &pvTable[1][1], &pvTable[1][pvLength[1]]);
             if (debuggbm) std::cout << "New best move: " << moveToString(bestMoveSoFar)
                       << " with score = " << bestEvalSoFar << "\n";
         }
-        alpha = std::max(alpha, eval);
 
         moveIndex++;
         if (debuggbm) std::cout << "\n\n";
+        if (alpha >= beta) {
+            break;  // Fail high: the window has to be widened
+        }
     }
     if (debuggbm) std::cout << "Best move at depth " << depth << ": " << moveToString(bestMoveSoFar)
               << " with score = " << bestEvalSoFar << "\n";
-    return;
+    return bestScore;
+}
+
+/**
+ * Searches the root to one depth inside an aspiration window.
+ *
+ * - From ASPIRATION_MIN_DEPTH on, the window starts ASPIRATION_WINDOW either side of the
+ *   previous iteration's score; mate scores and shallower depths get the full window.
+ * - A fail low lowers alpha and a fail high raises beta, by twice as much each time.
+ *   After a fail high the move that failed high is searched first.
+ * - Once the score is inside the window, the root moves are sorted by their scores for
+ *   the next iteration.
+ *
+ * @param depth The depth to search to.
+ */
+void Search::aspirationSearch(int depth) {
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -999999;
+    int beta = 999999;
+    if (depth >= ASPIRATION_MIN_DEPTH && std::abs(bestEvalSoFar) < MATE_BOUND) {
+        alpha = std::max(bestEvalSoFar - delta, -999999);
+        beta = std::min(bestEvalSoFar + delta, 999999);
+    }
+
+    while (true) {
+        scoredMoves.clear();
+        int score = getBestMove(depth, alpha, beta);
+        if (searchInterrupted) return;
+
+        if (score <= alpha && alpha > -999999) {
+            delta *= 2;
+            alpha = std::max(score - delta, -999999);
+        } else if (score >= beta && beta < 999999) {
+            delta *= 2;
+            beta = std::min(score + delta, 999999);
+            for (size_t i = 1; i < orderedLegalMoves.size(); ++i) {
+                if (orderedLegalMoves[i].move == bestMoveSoFar) {
+                    std::rotate(orderedLegalMoves.begin(), orderedLegalMoves.begin() + i,
+                                orderedLegalMoves.begin() + i + 1);
+                }
+            }
+        } else {
+            break;
+        }
+    }
+
+    // Search the root moves in order of their scores next iteration
+    scoredMoves.sort();
+    orderedLegalMoves = scoredMoves;
 }
 
 /**
  * Performs Iterative Deepening Search (IDS) to find the best move.
  *
- * - Starts at depth 1 and incrementally increases the search depth.
- * - Uses `shouldStopSearch()` to respect time constraints.
- * - Calls `getBestMove(depth)` at each iteration to perform a full-depth search.
+ * - Starts at depth 1 and incrementally increases the search depth, up to the depth limit.
+ * - Only searches the root moves given by `go searchmoves`, if any.
+ * - Stops early once `go mate N` is satisfied.
+ * - Helper threads of a parallel search use a per-thread depth offset.
+ * - Uses `shouldStopSearch()` to respect the hard time limit, and on the main thread stops
+ *   starting new iterations once the soft limit (scaled by best-move stability) is used up.
+ * - Calls `aspirationSearch(depth)` at each iteration to perform a full-depth search.
  * - Uses move ordering to improve search efficiency in subsequent iterations.
  * - Stores the best move found at the deepest completed depth.
+ * - Sends an info line (score, nodes, nps, hashfull, pv) after every completed iteration.
  *
  * @return The best move found during the search.
  */
 uint16_t Search::iterativeDeepening() {
-    startTime = std::chrono::steady_clock::now();
-    orderedLegalMoves = orderMoves(board, allLegalMoves(board));
+    timeManager.start();
+    if (!stopSignal) table.newSearch();  // A parallel search is aged once by the thread pool
+    orderedLegalMoves = allLegalMoves(board);
+    orderMoves(board, orderedLegalMoves);
+    if (!searchMoves.empty()) {
+        // `go searchmoves`: only the listed root moves are searched
+        MoveList allowedMoves;
+        for (uint16_t move : orderedLegalMoves) {
+            if (std::find(searchMoves.begin(), searchMoves.end(), move) != searchMoves.end()) {
+                allowedMoves.push_back(move);
+            }
+        }
+        orderedLegalMoves = allowedMoves;
+    }
+    uint16_t previousBestMove = 0;
     for (int depth = 1; depth <= maxDepth; ++depth) {
         if (shouldStopSearch()) {
             break;
         }
 
+        // Lazy SMP: odd helper threads run one ply ahead of the main thread so the
+        // threads spread over different depths and fill the shared table for each other.
+        // ABDADA threads share the same depth and split the work by deferring moves instead.
+        int depthOffset = searchingMoves ? 0 : (threadId & 1);
+        int searchDepth = std::min(maxDepth, depth + depthOffset);
+        if (searchDepth <= completedDepth) {
+            continue;
+        }
+
         // Perform depth-first search at the current depth.
-        getBestMove(depth);
+        selDepth = 0;
+        aspirationSearch(searchDepth);
+        if (!searchInterrupted) {
+            completedDepth = searchDepth;
+            if (printInfo) printIterationInfo(searchDepth, bestEvalSoFar);
+            bestMoveStability = (bestMoveSoFar == previousBestMove) ? bestMoveStability + 1 : 0;
+            previousBestMove = bestMoveSoFar;
+        }
 
-        // Sort the vector
-        std::sort(scoredMoves.begin(), scoredMoves.end(), std::greater<>());
+        // Another iteration would likely not finish in the time left
+        if (threadId == 0 && !pondering && timeManager.softLimitReached(bestMoveStability)) {
+            break;
+        }
 
-        // Extract the moves in sorted order
-        std::vector<uint16_t> orderedMoves;
-        for (const auto& scoredMove : scoredMoves) {
-            orderedMoves.push_back(scoredMove.second);
+        // `go mate N`: a mate for us in at most N moves has been found
+        if (mateLimit > 0 && !searchInterrupted && bestEvalSoFar >= MATE_BOUND &&
+            MATE_SCORE - bestEvalSoFar <= 2 * mateLimit - 1) {
+            break;
         }
-        orderedLegalMoves = orderedMoves;
-        scoredMoves.clear();
     }
 
     return bestMoveSoFar;
 }
 
+/**
+ * Finds the reply we expect to the best move, for `bestmove ... ponder ...`.
+ *
+ * - Looks up the position after the best move in the transposition table and takes its
+ *   stored move, if it is legal there.
+ *
+ * @return The expected reply, or 0 if there is none.
+ */
+uint16_t Search::getPonderMove() {
+    if (bestMoveSoFar == 0) return 0;
+
+    uint16_t ponderMove = 0;
+    MoveUndo undoData = applyMove(board, bestMoveSoFar);
+    TranspositionTableEntry entry;
+    if (getTranspositionTableEntry(table, board.getZobristHash(), entry) && entry.bestMove) {
+        if (allLegalMoves(board).contains(entry.bestMove)) {
+            ponderMove = entry.bestMove;
+        }
+    }
+    undoMove(board, undoData);
+    return ponderMove;
+}
+
 /**
  * Searches for the best move to a fixed depth.
  *
@@ -757,9 +1488,22 @@ uint16_t Search::iterativeDeepening() {
  * @return The best move found at the given depth.
  */
 uint16_t Search::searchToDepth(int depth) {
-    startTime = std::chrono::steady_clock::now();
-    orderedLegalMoves = orderMoves(board, allLegalMoves(board));
-    std::cout << moveToString(orderedLegalMoves[0]) << std::endl;
-    getBestMove(depth);
+    timeManager.start();
+    if (!stopSignal) table.newSearch();
+    orderedLegalMoves = allLegalMoves(board);
+    orderMoves(board, orderedLegalMoves);
+    std::cout << moveToString(orderedLegalMoves[0].move) << std::endl;
+    getBestMove(depth, -999999, 999999);
     return bestMoveSoFar;
 }
+
+/**
+ * Runs a quiescence search on the root position with a full window.
+ *
+ * - Used by the QSearch benchmark to time quiescence search on its own.
+ *
+ * @return The quiescence score of the root position.
+ */
+int Search::quiescence() {
+    return QSearch(-999999, 999999);
+}
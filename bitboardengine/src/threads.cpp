@@ -0,0 +1,290 @@
+#include "threads.hpp"
+
+/**
+ * Allocates an empty table.
+ */
+SearchingMovesTable::SearchingMovesTable()
+    : slots(new std::atomic<uint64_t>[SEARCHING_MOVES_SIZE]) {
+    clear();
+}
+
+/**
+ * Combines a position and a move into one key.
+ *
+ * @param zobristHash The hash of the position the move is played from.
+ * @param move The move.
+ * @return A non-zero key (zero marks an empty slot).
+ */
+uint64_t SearchingMovesTable::moveKey(uint64_t zobristHash, uint16_t move) {
+    uint64_t key = zobristHash ^ (uint64_t(move) * 0x9E3779B97F4A7C15ULL);
+    return key ? key : 1;
+}
+
+/**
+ * @param key A key from `moveKey`.
+ * @return True if some thread is currently searching that move.
+ */
+bool SearchingMovesTable::isSearching(uint64_t key) const {
+    return slots[key & (SEARCHING_MOVES_SIZE - 1)].load(std::memory_order_relaxed) == key;
+}
+
+/**
+ * Marks a move as being searched, replacing whatever the slot held.
+ *
+ * @param key A key from `moveKey`.
+ */
+void SearchingMovesTable::startSearching(uint64_t key) {
+    slots[key & (SEARCHING_MOVES_SIZE - 1)].store(key, std::memory_order_relaxed);
+}
+
+/**
+ * Clears the mark of a move, unless another key has taken over the slot since.
+ *
+ * @param key A key from `moveKey`.
+ */
+void SearchingMovesTable::finishSearching(uint64_t key) {
+    uint64_t expected = key;
+    slots[key & (SEARCHING_MOVES_SIZE - 1)].compare_exchange_strong(expected, 0,
+                                                                  std::memory_order_relaxed);
+}
+
+/**
+ * Empties every slot.
+ */
+void SearchingMovesTable::clear() {
+    for (int i = 0; i < SEARCHING_MOVES_SIZE; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Starts a worker thread and waits until it is parked in its idle loop.
+ *
+ * @param poolParam The pool the thread belongs to.
+ * @param idParam The index of the thread (0 is the main search thread).
+ */
+SearchThread::SearchThread(ThreadPool& poolParam, int idParam)
+    : pool(poolParam), id(idParam), searching(true), exit(false),
+      thread(&SearchThread::idleLoop, this) {
+    history.clear();
+    waitForSearchFinished();
+}
+
+/**
+ * Wakes the thread with the exit flag set and joins it.
+ */
+SearchThread::~SearchThread() {
+    exit = true;
+    startSearching();
+    thread.join();
+}
+
+/**
+ * Wakes the thread to run its search.
+ */
+void SearchThread::startSearching() {
+    std::lock_guard<std::mutex> lock(mutex);
+    searching = true;
+    cv.notify_one();
+}
+
+/**
+ * Blocks until the thread has finished its current search and is idle again.
+ */
+void SearchThread::waitForSearchFinished() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return !searching; });
+}
+
+/**
+ * The body of the worker: sleep until woken, search, repeat.
+ *
+ * - Thread 0 drives the whole parallel search, the others only run their own
+ *   iterative deepening until the shared stop flag is raised.
+ */
+void SearchThread::idleLoop() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        searching = false;
+        cv.notify_one();  // Wake anyone waiting for the search to finish
+        cv.wait(lock, [&] { return searching; });
+
+        if (exit) return;
+        lock.unlock();
+
+        if (id == 0) {
+            pool.mainThreadSearch();
+        } else {
+            search->iterativeDeepening();
+        }
+    }
+}
+
+/**
+ * Creates a pool with a single (main) search thread.
+ */
+ThreadPool::ThreadPool()
+    : stop(false), ponder(false), bestMove(0), ponderMove(0), completedDepth(0), infinite(false),
+      printUciOutput(false) {
+    set(1);
+}
+
+/**
+ * Stops any running search and joins every thread.
+ */
+ThreadPool::~ThreadPool() {
+    stop = true;
+    set(0);
+}
+
+/**
+ * Resizes the pool. Threads are only created or destroyed here, never per search.
+ *
+ * @param count The number of search threads, including the main thread.
+ */
+void ThreadPool::set(size_t count) {
+    if (!threads.empty()) {
+        waitForSearchFinished();
+    }
+    threads.clear();
+    count = std::min<size_t>(count, MAX_THREADS);
+    for (size_t i = 0; i < count; ++i) {
+        threads.push_back(std::make_unique<SearchThread>(*this, int(i)));
+    }
+}
+
+/**
+ * Prepares one Search per thread and wakes the main thread. Returns immediately.
+ *
+ * - Every thread gets its own copy of the board and its own stacks; the transposition
+ *   table in `context` is shared.
+ * - The table is aged once here, before any thread writes to it, and so is the history of
+ *   every thread.
+ *
+ * @param board The position to search.
+ * @param context The engine context holding the shared table and game history.
+ * @param limits The time and depth limits for the search.
+ * @param printUciOutputParam Whether the main thread sends info lines and `bestmove`.
+ */
+void ThreadPool::startThinking(const BoardState& board, SearchContext& context,
+                               const SearchLimits& limits, bool printUciOutputParam) {
+    waitForSearchFinished();
+    stop = false;
+    ponder = limits.ponder;
+    bestMove = 0;
+    ponderMove = 0;
+    completedDepth = 0;
+    infinite = limits.infinite;
+    printUciOutput = printUciOutputParam;
+    context.table.newSearch();
+    context.searchingMoves.clear();
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->history.age();
+        threads[i]->search = std::make_unique<Search>(board, context, limits, int(i), &stop,
+                                                     printUciOutput && i == 0,
+                                                     &threads[i]->history);
+    }
+    threads[0]->startSearching();
+}
+
+/**
+ * Blocks until the main thread has finished (and therefore all helpers too).
+ */
+void ThreadPool::waitForSearchFinished() { threads[0]->waitForSearchFinished(); }
+
+/**
+ * Runs on thread 0: searches alongside the helpers, then picks the result.
+ *
+ * - When the main thread finishes (time or depth limit), the helpers are stopped. An
+ *   infinite or ponder search holds on to its result until `stop` (or `ponderhit` when
+ *   pondering) arrives, as UCI requires. Buffered info lines are written before waiting.
+ * - The move comes from the thread that completed the deepest iteration; ties go to
+ *   the lowest thread index, so the main thread wins unless a helper got further.
+ */
+void ThreadPool::mainThreadSearch() {
+    for (size_t i = 1; i < threads.size(); ++i) {
+        threads[i]->startSearching();
+    }
+
+    threads[0]->search->iterativeDeepening();
+
+    // The last iterations' info lines may still be buffered; nothing polls the
+    // buffer while we wait, so send them before waiting for `stop`
+    uciOutput.flush();
+    while ((infinite || ponder) && !stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop = true;
+    for (size_t i = 1; i < threads.size(); ++i) {
+        threads[i]->waitForSearchFinished();
+    }
+
+    Search* best = threads[0]->search.get();
+    for (size_t i = 1; i < threads.size(); ++i) {
+        Search* candidate = threads[i]->search.get();
+        if (candidate->getBestMoveSoFar() != 0 &&
+            candidate->getCompletedDepth() > best->getCompletedDepth()) {
+            best = candidate;
+        }
+    }
+    bestMove = best->getBestMoveSoFar();
+    ponderMove = best->getPonderMove();
+    completedDepth = best->getCompletedDepth();
+
+    if (printUciOutput) {
+        std::string output = "bestmove " + moveToString(bestMove);
+        if (ponderMove) output += " ponder " + moveToString(ponderMove);
+        uciOutput.write(output, true);
+    }
+}
+
+/**
+ * @return The total number of nodes searched by all threads in the last search.
+ */
+uint64_t ThreadPool::nodesSearched() const {
+    uint64_t nodes = 0;
+    for (const auto& thread : threads) {
+        if (thread->search) nodes += thread->search->getStats().nodes;
+    }
+    return nodes;
+}
+
+/**
+ * Sums the beta cutoff counters of all threads in the last search.
+ *
+ * @param betaCutoffs Set to the number of beta cutoffs.
+ * @param firstMoveCutoffs Set to the number of those that came on the first move searched.
+ */
+void ThreadPool::cutoffCounts(uint64_t& betaCutoffs, uint64_t& firstMoveCutoffs) const {
+    betaCutoffs = 0;
+    firstMoveCutoffs = 0;
+    for (const auto& thread : threads) {
+        if (thread->search) {
+            betaCutoffs += thread->search->getStats().betaCutoffs;
+            firstMoveCutoffs += thread->search->getStats().firstMoveCutoffs;
+        }
+    }
+}
+
+/**
+ * Wipes the history tables of every thread.
+ */
+void ThreadPool::clearHistory() {
+    waitForSearchFinished();
+    for (const auto& thread : threads) {
+        thread->history.clear();
+    }
+}
+
+/**
+ * Resets the context to a fresh game.
+ *
+ * - Wipes the transposition table and the history of every thread.
+ * - Called on `ucinewgame` only; between moves of a game everything is kept.
+ */
+void SearchContext::clear() {
+    threads.waitForSearchFinished();
+    table.clear();
+    threads.clearHistory();
+}
@@ -0,0 +1,80 @@
+#include "timeman.hpp"
+#include <algorithm>
+
+// Soft limit scale by the number of iterations the best move has survived unchanged
+static const double STABILITY_SCALE[] = {1.30, 1.00, 0.85, 0.75, 0.65};
+
+/**
+ * Computes the soft and hard limits for the next move.
+ *
+ * - `movetime` is used as is for both limits, minus the move overhead.
+ * - Otherwise the remaining time (minus the move overhead) is spread over `movestogo`
+ *   moves, or DEFAULT_MOVES_TO_GO in sudden death, and most of the increment is added
+ *   since it comes back after the move.
+ * - The hard limit allows a few times the soft limit for unstable positions, but never
+ *   more than 80% of what is left on the clock.
+ * - Without `movetime` or clock time the search is unlimited.
+ *
+ * @param timeLeftMs The time left on our clock, or -1 if not given.
+ * @param incrementMs Our increment per move.
+ * @param movestogo The moves until the next time control, or 0 in sudden death.
+ * @param movetimeMs A fixed time for this move, or -1.
+ * @param moveOverheadMs Time reserved per move for communication delays.
+ */
+void TimeManager::init(int timeLeftMs, int incrementMs, int movestogo, int movetimeMs,
+                       int moveOverheadMs) {
+    fixedMoveTime = false;
+    softLimitMs = hardLimitMs = -1;
+
+    if (movetimeMs >= 0) {
+        fixedMoveTime = true;
+        softLimitMs = hardLimitMs = std::max(1, movetimeMs - moveOverheadMs);
+        return;
+    }
+    if (timeLeftMs < 0) {
+        return;
+    }
+
+    int movesLeft = movestogo > 0 ? std::min(movestogo, DEFAULT_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+    int64_t available = std::max<int64_t>(1, int64_t(timeLeftMs) - moveOverheadMs);
+    int64_t maximum = std::max<int64_t>(1, available * 8 / 10);
+
+    softLimitMs = std::min(maximum, available / movesLeft + incrementMs * 3 / 4);
+    hardLimitMs = std::min(maximum, softLimitMs * 4);
+    softLimitMs = std::max<int64_t>(1, softLimitMs);
+}
+
+/**
+ * Starts the clock for this move.
+ */
+void TimeManager::start() { startTime = std::chrono::steady_clock::now(); }
+
+/**
+ * @return The milliseconds since `start`.
+ */
+int64_t TimeManager::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - startTime)
+        .count();
+}
+
+/**
+ * @return True if the search must be aborted now.
+ */
+bool TimeManager::hardLimitReached() const { return isLimited() && elapsedMs() >= hardLimitMs; }
+
+/**
+ * Decides whether to start another iteration.
+ *
+ * - A best move that keeps changing earns more time, a stable one less.
+ * - A fixed `movetime` is not scaled.
+ *
+ * @param bestMoveStability The number of iterations the best move has stayed the same.
+ * @return True if no further iteration should be started.
+ */
+bool TimeManager::softLimitReached(int bestMoveStability) const {
+    if (!isLimited()) return false;
+
+    double scale = fixedMoveTime ? 1.0 : STABILITY_SCALE[std::min(bestMoveStability, 4)];
+    return elapsedMs() >= int64_t(softLimitMs * scale);
+}